@@ -0,0 +1,94 @@
+/* malloc-bench.c
+
+   Exercises malloc() and free() with a mix of small and large
+   blocks, the way a program builds and tears down data
+   structures, and reports how much heap that took and how many
+   pages became resident.  For comparison, it also prints the size
+   of the static arrays a program would need to hold the same
+   blocks without a heap.
+
+   Usage: malloc-bench [OPERATIONS] */
+
+#include <malloc.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Blocks live at a time, at most. */
+#define SLOT_CNT 1024
+
+/* Largest block, in bytes. */
+#define BLOCK_MAX (8 * 1024)
+
+static char *blocks[SLOT_CNT];
+static size_t sizes[SLOT_CNT];
+
+/* Returns a block size: mostly small, now and then large. */
+static size_t
+random_size (void)
+{
+  if (random_ulong () % 16 == 0)
+    return random_ulong () % BLOCK_MAX + 1;
+  return random_ulong () % 256 + 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int op_cnt = argc > 1 ? atoi (argv[1]) : 20000;
+  char *start = sbrk (0);
+  size_t live = 0, live_peak = 0, heap_peak = 0;
+  struct memstat before, after;
+  int i;
+
+  random_init (0);
+  memstat (&before);
+  for (i = 0; i < op_cnt; i++)
+    {
+      int slot = random_ulong () % SLOT_CNT;
+      size_t heap;
+
+      if (blocks[slot] != NULL)
+        {
+          free (blocks[slot]);
+          blocks[slot] = NULL;
+          live -= sizes[slot];
+        }
+      else
+        {
+          sizes[slot] = random_size ();
+          blocks[slot] = malloc (sizes[slot]);
+          if (blocks[slot] == NULL)
+            {
+              printf ("malloc-bench: out of memory after %d operations\n",
+                      i);
+              return EXIT_FAILURE;
+            }
+          /* Touch the block as a program would. */
+          blocks[slot][0] = blocks[slot][sizes[slot] - 1] = 1;
+          live += sizes[slot];
+          if (live > live_peak)
+            live_peak = live;
+        }
+      heap = (char *) sbrk (0) - start;
+      if (heap > heap_peak)
+        heap_peak = heap;
+    }
+  memstat (&after);
+
+  printf ("malloc-bench: %d operations, %zu kB live at peak\n",
+          op_cnt, live_peak / 1024);
+  printf ("malloc-bench: heap peaked at %zu kB (%zu%% used), "
+          "%zu pages made resident\n", heap_peak / 1024,
+          heap_peak > 0 ? live_peak * 100 / heap_peak : 0,
+          after.rss - before.rss);
+  printf ("malloc-bench: static arrays for the same blocks: %zu kB\n",
+          (size_t) SLOT_CNT * BLOCK_MAX / 1024);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    free (blocks[i]);
+  printf ("malloc-bench: heap after freeing everything: %zu kB\n",
+          (size_t) ((char *) sbrk (0) - start) / 1024);
+  return EXIT_SUCCESS;
+}
@@ -28,7 +28,16 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Virtual memory extensions. */
+    SYS_FORK,                   /* Clone the current process. */
+    SYS_MADVISE,                /* Advise on memory use. */
+    SYS_MSYNC,                  /* Write back a memory mapping. */
+    SYS_MLOCK,                  /* Pin pages in memory. */
+    SYS_MUNLOCK,                /* Unpin pages. */
+    SYS_MEMSTAT,                /* Report memory use. */
+    SYS_SBRK                    /* Move the program break. */
   };
 
 #endif /* lib/syscall-nr.h */
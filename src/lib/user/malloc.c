@@ -0,0 +1,397 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A user-space malloc(), on top of the heap grown by sbrk().
+
+   It is laid out like the kernel's threads/malloc.c.  Requests of
+   up to 1 kB are rounded up to a power of 2 and served from the
+   free list of the "descriptor" for that size class.  When the
+   list is empty, a page of heap, called an "arena", is divided
+   into blocks of that size which go on the list.  Once all
+   blocks of an arena are free again, the arena goes back to the
+   page allocator.
+
+   Bigger requests get whole pages with the arena header at the
+   beginning of the first one.
+
+   Free pages are kept in a list of runs sorted by address and
+   merged with their neighbours.  Runs are taken first fit and
+   split, and new pages come from sbrk().  A run that ends at the
+   program break is given back to the kernel with sbrk() instead,
+   so a heap shrinks again once its top is freed.  Heap pages
+   only get memory when they are first touched. */
+
+#define PAGE_SIZE 4096
+
+/* Descriptor. */
+struct desc
+  {
+    size_t block_size;          /* Size of each element in bytes. */
+    size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    struct block *free_list;    /* List of free blocks. */
+  };
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x9a548eed
+
+/* Arena. */
+struct arena 
+  {
+    unsigned magic;             /* Always set to ARENA_MAGIC. */
+    struct desc *desc;          /* Owning descriptor, null for big block. */
+    size_t free_cnt;            /* Free blocks; pages in big block. */
+  };
+
+/* Free block. */
+struct block 
+  {
+    struct block *prev;         /* Previous free block. */
+    struct block *next;         /* Next free block. */
+  };
+
+/* Run of free pages. */
+struct run
+  {
+    size_t page_cnt;            /* Number of pages. */
+    struct run *next;           /* Next run, at a higher address. */
+  };
+
+/* Our set of descriptors. */
+static struct desc descs[8];    /* Descriptors. */
+static size_t desc_cnt;         /* Number of descriptors. */
+
+/* Free pages. */
+static struct run *free_runs;
+
+static void malloc_init (void);
+static void *page_alloc (size_t page_cnt);
+static void page_free (void *, size_t page_cnt);
+static struct arena *block_to_arena (struct block *);
+static struct block *arena_to_block (struct arena *, size_t idx);
+static void block_push (struct desc *, struct block *);
+static void block_remove (struct desc *, struct block *);
+
+/* Initializes the malloc() descriptors. */
+static void
+malloc_init (void) 
+{
+  size_t block_size;
+
+  for (block_size = 16; block_size < PAGE_SIZE / 2; block_size *= 2)
+    {
+      struct desc *d = &descs[desc_cnt++];
+      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+      d->block_size = block_size;
+      d->blocks_per_arena = (PAGE_SIZE - sizeof (struct arena)) / block_size;
+      d->free_list = NULL;
+    }
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) 
+{
+  struct desc *d;
+  struct block *b;
+  struct arena *a;
+
+  /* A null pointer satisfies a request for 0 bytes. */
+  if (size == 0)
+    return NULL;
+  if (desc_cnt == 0)
+    malloc_init ();
+
+  /* Find the smallest descriptor that satisfies a SIZE-byte
+     request. */
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->block_size >= size)
+      break;
+  if (d == descs + desc_cnt) 
+    {
+      /* SIZE is too big for any descriptor.
+         Allocate enough pages to hold SIZE plus an arena. */
+      size_t page_cnt;
+
+      if (size > SIZE_MAX - sizeof *a - PAGE_SIZE)
+        return NULL;
+      page_cnt = DIV_ROUND_UP (size + sizeof *a, PAGE_SIZE);
+      a = page_alloc (page_cnt);
+      if (a == NULL)
+        return NULL;
+
+      /* Initialize the arena to indicate a big block of PAGE_CNT
+         pages, and return it. */
+      a->magic = ARENA_MAGIC;
+      a->desc = NULL;
+      a->free_cnt = page_cnt;
+      return a + 1;
+    }
+
+  /* If the free list is empty, create a new arena. */
+  if (d->free_list == NULL)
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = page_alloc (1);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = d->blocks_per_arena; i-- > 0; ) 
+        block_push (d, arena_to_block (a, i));
+    }
+
+  /* Get a block from free list and return it. */
+  b = d->free_list;
+  block_remove (d, b);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) 
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+  size = a * b;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) 
+{
+  struct block *b = block;
+  struct arena *a = block_to_arena (b);
+  struct desc *d = a->desc;
+
+  return d != NULL ? d->block_size : PAGE_SIZE * a->free_cnt - sizeof *a;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) 
+{
+  if (new_size == 0) 
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block != NULL && new_size <= block_size (old_block)
+           && new_size > block_size (old_block) / 2)
+    /* Still the right size class. */
+    return old_block;
+  else 
+    {
+      void *new_block = malloc (new_size);
+      if (old_block != NULL && new_block != NULL)
+        {
+          size_t old_size = block_size (old_block);
+          size_t min_size = new_size < old_size ? new_size : old_size;
+          memcpy (new_block, old_block, min_size);
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) 
+{
+  if (p != NULL)
+    {
+      struct block *b = p;
+      struct arena *a = block_to_arena (b);
+      struct desc *d = a->desc;
+      
+      if (d != NULL) 
+        {
+          /* It's a normal block.  We handle it here. */
+
+#ifndef NDEBUG
+          /* Clear the block to help detect use-after-free bugs. */
+          memset (b, 0xcc, d->block_size);
+#endif
+
+          /* Add block to free list. */
+          block_push (d, b);
+
+          /* If the arena is now entirely unused, free it. */
+          if (++a->free_cnt >= d->blocks_per_arena) 
+            {
+              size_t i;
+
+              ASSERT (a->free_cnt == d->blocks_per_arena);
+              for (i = 0; i < d->blocks_per_arena; i++) 
+                block_remove (d, arena_to_block (a, i));
+              page_free (a, 1);
+            }
+        }
+      else
+        {
+          /* It's a big block.  Free its pages. */
+          page_free (a, a->free_cnt);
+        }
+    }
+}
+
+/* Returns PAGE_CNT contiguous free pages, from the free runs or
+   else from sbrk(), or a null pointer if the heap cannot grow. */
+static void *
+page_alloc (size_t page_cnt) 
+{
+  struct run **rp;
+  uint8_t *brk;
+
+  for (rp = &free_runs; *rp != NULL; rp = &(*rp)->next)
+    {
+      struct run *r = *rp;
+      if (r->page_cnt > page_cnt)
+        {
+          /* Take the tail of the run. */
+          r->page_cnt -= page_cnt;
+          return (uint8_t *) r + r->page_cnt * PAGE_SIZE;
+        }
+      if (r->page_cnt == page_cnt)
+        {
+          *rp = r->next;
+          return r;
+        }
+    }
+
+  /* Keep the heap page-aligned. */
+  brk = sbrk (0);
+  if (brk == SBRK_FAILED 
+      || sbrk (ROUND_UP ((uintptr_t) brk, PAGE_SIZE) - (uintptr_t) brk)
+         == SBRK_FAILED)
+    return NULL;
+  if (page_cnt > (size_t) INTPTR_MAX / PAGE_SIZE)
+    return NULL;
+  brk = sbrk (page_cnt * PAGE_SIZE);
+  return brk != SBRK_FAILED ? brk : NULL;
+}
+
+/* Returns the PAGE_CNT pages at PAGES to the free runs, merging
+   them with adjacent runs.  A run that ends at the program break
+   goes back to the kernel. */
+static void
+page_free (void *pages, size_t page_cnt) 
+{
+  struct run *r = pages;
+  struct run **rp, *prev = NULL;
+
+  for (rp = &free_runs; *rp != NULL && *rp < r; rp = &(*rp)->next)
+    prev = *rp;
+  r->page_cnt = page_cnt;
+  r->next = *rp;
+  *rp = r;
+
+  /* Merge with the next run, then with the previous one. */
+  if (r->next != NULL
+      && (uint8_t *) r + r->page_cnt * PAGE_SIZE == (uint8_t *) r->next)
+    {
+      r->page_cnt += r->next->page_cnt;
+      r->next = r->next->next;
+    }
+  if (prev != NULL
+      && (uint8_t *) prev + prev->page_cnt * PAGE_SIZE == (uint8_t *) r)
+    {
+      prev->page_cnt += r->page_cnt;
+      prev->next = r->next;
+      r = prev;
+    }
+
+  /* The last run may reach the break. */
+  if (r->next == NULL
+      && (uint8_t *) r + r->page_cnt * PAGE_SIZE == (uint8_t *) sbrk (0))
+    {
+      for (rp = &free_runs; *rp != r; rp = &(*rp)->next)
+        continue;
+      *rp = NULL;
+      sbrk (-(intptr_t) (r->page_cnt * PAGE_SIZE));
+    }
+}
+
+/* Adds block B to the front of D's free list. */
+static void
+block_push (struct desc *d, struct block *b) 
+{
+  b->prev = NULL;
+  b->next = d->free_list;
+  if (b->next != NULL)
+    b->next->prev = b;
+  d->free_list = b;
+}
+
+/* Removes block B from D's free list. */
+static void
+block_remove (struct desc *d, struct block *b) 
+{
+  if (b->prev != NULL)
+    b->prev->next = b->next;
+  else
+    d->free_list = b->next;
+  if (b->next != NULL)
+    b->next->prev = b->prev;
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (struct block *b)
+{
+  struct arena *a = (struct arena *) ((uintptr_t) b & ~(PAGE_SIZE - 1));
+
+  /* Check that the arena is valid. */
+  ASSERT (a != NULL);
+  ASSERT (a->magic == ARENA_MAGIC);
+
+  /* Check that the block is properly aligned for the arena. */
+  ASSERT (a->desc == NULL
+          || ((uintptr_t) b % PAGE_SIZE - sizeof *a)
+             % a->desc->block_size == 0);
+  ASSERT (a->desc != NULL || (uintptr_t) b % PAGE_SIZE == sizeof *a);
+
+  return a;
+}
+
+/* Returns the (IDX - 1)'th block within arena A. */
+static struct block *
+arena_to_block (struct arena *a, size_t idx) 
+{
+  ASSERT (a != NULL);
+  ASSERT (a->magic == ARENA_MAGIC);
+  ASSERT (idx < a->desc->blocks_per_arena);
+  return (struct block *) ((uint8_t *) a
+                           + sizeof *a
+                           + idx * a->desc->block_size);
+}
@@ -182,3 +182,52 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+int
+madvise (void *addr, unsigned length, int advice)
+{
+  return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+msync (void *addr, unsigned length, int flags)
+{
+  return syscall3 (SYS_MSYNC, addr, length, flags);
+}
+
+int
+mlock (const void *addr, unsigned length)
+{
+  return syscall2 (SYS_MLOCK, addr, length);
+}
+
+int
+munlock (const void *addr, unsigned length)
+{
+  return syscall2 (SYS_MUNLOCK, addr, length);
+}
+
+bool
+memstat (struct memstat *ms)
+{
+  return syscall1 (SYS_MEMSTAT, ms);
+}
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+brk (void *addr)
+{
+  void *old_brk = sbrk (0);
+  return sbrk ((char *) addr - (char *) old_brk) != SBRK_FAILED ? 0 : -1;
+}
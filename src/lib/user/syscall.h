@@ -2,6 +2,8 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -12,6 +14,31 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Returned by sbrk() on failure. */
+#define SBRK_FAILED ((void *) -1)
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* Default paging. */
+#define MADV_RANDOM 1           /* Expect random accesses. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential accesses. */
+#define MADV_WILLNEED 3         /* Expect access soon. */
+#define MADV_DONTNEED 4         /* Contents no longer needed. */
+
+/* Flags for msync(). */
+#define MS_ASYNC 1              /* Queue the write-back. */
+#define MS_INVALIDATE 2         /* Accepted, has no effect. */
+#define MS_SYNC 4               /* Write back before returning. */
+
+/* Memory use of a process, filled in by memstat(), in pages. */
+struct memstat
+  {
+    size_t rss;                 /* Resident pages. */
+    size_t wss;                 /* Pages used in the last interval. */
+    size_t rss_max;             /* Resident page cap, 0 if none. */
+    size_t pinned;              /* Pages locked by mlock(). */
+    size_t swapped;             /* Swap slots held. */
+  };
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -45,4 +72,14 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Virtual memory extensions. */
+pid_t fork (void);
+int madvise (void *addr, unsigned length, int advice);
+int msync (void *addr, unsigned length, int flags);
+int mlock (const void *addr, unsigned length);
+int munlock (const void *addr, unsigned length);
+bool memstat (struct memstat *);
+void *sbrk (intptr_t increment);
+int brk (void *addr);
+
 #endif /* lib/user/syscall.h */
@@ -177,6 +177,11 @@ sub compare_output {
 			&& !/^ esi=.* edi=.* esp=.* ebp=.*/
 			&& !/^ cs=.* ds=.* es=.* ss=.*/, @output);
     }
+    my $ignore_oom_kills = exists $options{IGNORE_OOM_KILLS};
+    if ($ignore_oom_kills) {
+	delete $options{IGNORE_OOM_KILLS};
+	@output = grep (!/^oom: /, @output);
+    }
     die "unknown option " . (keys (%options))[0] . "\n" if %options;
 
     my ($msg);
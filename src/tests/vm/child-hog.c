@@ -0,0 +1,27 @@
+/* Child process of oom-kill.
+   Fills 4 MB with a key stream that does not compress, most of what
+   memory and swap can hold, creates "hog-ready" and then spins in user
+   mode until it is killed. */
+
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+static char buf[SIZE];
+
+int
+main (void)
+{
+  struct arc4 arc4;
+
+  test_name = "child-hog";
+
+  arc4_init (&arc4, "hog", 3);
+  arc4_crypt (&arc4, buf, SIZE);
+  if (!create ("hog-ready", 0))
+    fail ("create \"hog-ready\"");
+  for (;;)
+    continue;
+}
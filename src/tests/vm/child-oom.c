@@ -0,0 +1,23 @@
+/* Child process of oom.
+   Fills 8 MB with a key stream that does not compress, more than
+   memory and swap can hold, so it should be killed before the end. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (8 * 1024 * 1024)
+static char buf[SIZE];
+
+int
+main (void)
+{
+  struct arc4 arc4;
+
+  test_name = "child-oom";
+
+  arc4_init (&arc4, "oom", 3);
+  arc4_crypt (&arc4, buf, SIZE);
+  return 0;
+}
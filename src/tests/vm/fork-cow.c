@@ -0,0 +1,41 @@
+/* Forks a child that checks it sees the parent's memory, then
+   overwrites it.  The parent's copy must stay intact, since the
+   child's writes go to copy-on-write copies. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+  pid_t pid;
+
+  memset (buf, 0x5a, sizeof buf);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* Child. */
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != 0x5a)
+          fail ("child: byte %zu != 0x5a", i);
+      msg ("child sees parent's data");
+      memset (buf, 0xa5, sizeof buf);
+      exit (81);
+    }
+
+  if (pid == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (pid) == 81, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0x5a)
+      fail ("byte %zu != 0x5a", i);
+  msg ("parent's data intact");
+}
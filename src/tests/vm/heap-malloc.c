@@ -0,0 +1,80 @@
+/* Allocates blocks of random sizes with malloc(), from a few bytes
+   to several pages, fills each with its own pattern, frees and
+   reallocates some of them, and checks that no block overwrote
+   another.  Once every block is freed, the heap must have shrunk
+   back to where it started. */
+
+#include <malloc.h>
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 512
+#define SIZE_MAX_BYTES (3 * 4096)
+
+static char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+/* Allocates block I with a random size and fills it. */
+static void
+fill_block (size_t i)
+{
+  sizes[i] = random_ulong () % 4 == 0 
+             ? random_ulong () % SIZE_MAX_BYTES + 1
+             : random_ulong () % 200 + 1;
+  blocks[i] = malloc (sizes[i]);
+  if (blocks[i] == NULL)
+    fail ("malloc of %zu bytes failed", sizes[i]);
+  memset (blocks[i], i & 0xff, sizes[i]);
+}
+
+/* Fails unless every block still holds its pattern. */
+static void
+check_blocks (void)
+{
+  size_t i, j;
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < sizes[i]; j++)
+      if (blocks[i][j] != (char) (i & 0xff))
+        fail ("byte %zu of block %zu was overwritten", j, i);
+}
+
+void
+test_main (void)
+{
+  char *start = sbrk (0);
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < BLOCK_CNT; i++)
+    fill_block (i);
+  check_blocks ();
+  msg ("blocks intact after allocation");
+
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    {
+      free (blocks[i]);
+      fill_block (i);
+    }
+  for (i = 1; i < BLOCK_CNT; i += 4)
+    {
+      size_t old_size = sizes[i];
+      sizes[i] = old_size * 2 + 1;
+      blocks[i] = realloc (blocks[i], sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("realloc to %zu bytes failed", sizes[i]);
+      memset (blocks[i] + old_size, i & 0xff, sizes[i] - old_size);
+    }
+  check_blocks ();
+  msg ("blocks intact after free and realloc");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  if (sbrk (0) != start)
+    fail ("heap is %d bytes after freeing every block",
+          (int) ((char *) sbrk (0) - start));
+  msg ("heap shrank back");
+}
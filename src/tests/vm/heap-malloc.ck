@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(heap-malloc) begin
+(heap-malloc) blocks intact after allocation
+(heap-malloc) blocks intact after free and realloc
+(heap-malloc) heap shrank back
+(heap-malloc) end
+heap-malloc: exit(0)
+EOF
+pass;
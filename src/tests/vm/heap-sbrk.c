@@ -0,0 +1,48 @@
+/* Grows the heap with sbrk() and checks that the new memory reads
+   as zeros and keeps what is written to it.  Then shrinks the heap
+   back, grows it again and checks that the pages given back read as
+   zeros.  The break must not go below its start. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAP_SIZE (5 * 4096 + 100)
+
+/* Fails unless the SIZE bytes at P are all zero. */
+static void
+check_zero (const char *p, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != 0)
+      fail ("byte %zu of the heap is %d (should be 0)", i, p[i]);
+}
+
+void
+test_main (void)
+{
+  char *start = sbrk (0);
+  size_t i;
+
+  CHECK (start != SBRK_FAILED, "sbrk (0)");
+  CHECK (sbrk (HEAP_SIZE) == start, "grow heap");
+  CHECK (sbrk (0) == start + HEAP_SIZE, "break moved up");
+  check_zero (start, HEAP_SIZE);
+  memset (start, 0x5a, HEAP_SIZE);
+  for (i = 0; i < HEAP_SIZE; i++)
+    if (start[i] != 0x5a)
+      fail ("byte %zu of the heap changed", i);
+  msg ("heap keeps its data");
+
+  CHECK (sbrk (-HEAP_SIZE) == start + HEAP_SIZE, "shrink heap");
+  CHECK (sbrk (HEAP_SIZE) == start, "grow heap again");
+  check_zero (start, HEAP_SIZE);
+  msg ("pages given back read as zeros");
+
+  CHECK (sbrk (-(HEAP_SIZE + 1)) == SBRK_FAILED, "shrink below start");
+  CHECK (brk (start) == 0, "brk back to start");
+  CHECK (sbrk (0) == start, "break at start");
+}
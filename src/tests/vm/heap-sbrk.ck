@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(heap-sbrk) begin
+(heap-sbrk) sbrk (0)
+(heap-sbrk) grow heap
+(heap-sbrk) break moved up
+(heap-sbrk) heap keeps its data
+(heap-sbrk) shrink heap
+(heap-sbrk) grow heap again
+(heap-sbrk) pages given back read as zeros
+(heap-sbrk) shrink below start
+(heap-sbrk) brk back to start
+(heap-sbrk) break at start
+(heap-sbrk) end
+heap-sbrk: exit(0)
+EOF
+pass;
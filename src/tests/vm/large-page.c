@@ -0,0 +1,63 @@
+/* Run with "-large", touches one byte of a 4 MB block inside a big
+   zero-filled array and checks that the whole block became resident
+   with that one fault.  Then checks the block reads as zeros, fills
+   it, and forks a child that overwrites it, which splits the large
+   page in both processes.  The parent's copy must stay intact. */
+
+#include <round.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BLOCK_SIZE (4 * 1024 * 1024)
+#define BLOCK_PAGES (BLOCK_SIZE / PAGE_SIZE)
+
+static char buf[2 * BLOCK_SIZE];
+
+void
+test_main (void)
+{
+  char *block = (char *) ROUND_UP ((uintptr_t) buf, BLOCK_SIZE);
+  struct memstat before, after;
+  size_t i;
+  pid_t pid;
+
+  CHECK (memstat (&before), "memstat");
+  block[0] = 1;
+  CHECK (memstat (&after), "memstat after touching the block");
+  if (after.rss < before.rss + BLOCK_PAGES)
+    fail ("resident pages went from %zu to %zu after one fault",
+          before.rss, after.rss);
+  msg ("block is resident");
+
+  for (i = 1; i < BLOCK_SIZE; i++)
+    if (block[i] != 0)
+      fail ("byte %zu is %d (should be 0)", i, block[i]);
+  msg ("block is zeroed");
+
+  for (i = 0; i < BLOCK_PAGES; i++)
+    block[i * PAGE_SIZE] = i % 251;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* Child. */
+      for (i = 0; i < BLOCK_PAGES; i++)
+        if (block[i * PAGE_SIZE] != (char) (i % 251))
+          fail ("child: page %zu has the wrong data", i);
+      msg ("child sees parent's data");
+      for (i = 0; i < BLOCK_PAGES; i++)
+        block[i * PAGE_SIZE] = 0x5a;
+      exit (81);
+    }
+
+  if (pid == PID_ERROR)
+    fail ("fork");
+  CHECK (wait (pid) == 81, "wait for child");
+  for (i = 0; i < BLOCK_PAGES; i++)
+    if (block[i * PAGE_SIZE] != (char) (i % 251))
+      fail ("page %zu has the wrong data", i);
+  msg ("parent's data intact");
+}
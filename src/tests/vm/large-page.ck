@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(large-page) begin
+(large-page) memstat
+(large-page) memstat after touching the block
+(large-page) block is resident
+(large-page) block is zeroed
+(large-page) child sees parent's data
+large-page: exit(81)
+(large-page) wait for child
+(large-page) parent's data intact
+(large-page) end
+large-page: exit(0)
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Run with "-eager=64", which loads this program's file pages at 
+   exec.  Reads every page of its initialized data, read-only and 
+   writable, and checks that none of them had to be faulted in and 
+   that they hold what the program was linked with.  Then writes the 
+   writable data. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define DATA_PAGES 8
+
+static const char rodata[DATA_PAGES * PAGE_SIZE] =
+  {
+    [0 * PAGE_SIZE] = 1, [1 * PAGE_SIZE] = 2, [2 * PAGE_SIZE] = 3,
+    [3 * PAGE_SIZE] = 4, [4 * PAGE_SIZE] = 5, [5 * PAGE_SIZE] = 6,
+    [6 * PAGE_SIZE] = 7, [7 * PAGE_SIZE] = 8,
+  };
+
+static char data[DATA_PAGES * PAGE_SIZE] =
+  {
+    [0 * PAGE_SIZE] = 11, [1 * PAGE_SIZE] = 12, [2 * PAGE_SIZE] = 13,
+    [3 * PAGE_SIZE] = 14, [4 * PAGE_SIZE] = 15, [5 * PAGE_SIZE] = 16,
+    [6 * PAGE_SIZE] = 17, [7 * PAGE_SIZE] = 18,
+  };
+
+void
+test_main (void)
+{
+  struct memstat before, after;
+  int sum = 0;
+  size_t i;
+
+  CHECK (memstat (&before), "memstat");
+  for (i = 0; i < DATA_PAGES; i++)
+    sum += rodata[i * PAGE_SIZE] + data[i * PAGE_SIZE];
+  CHECK (memstat (&after), "memstat after reading the data");
+  if (after.rss > before.rss)
+    fail ("%zu pages faulted in after exec", after.rss - before.rss);
+  msg ("data was resident");
+
+  for (i = 0; i < DATA_PAGES; i++)
+    if (rodata[i * PAGE_SIZE] != (char) (i + 1)
+        || data[i * PAGE_SIZE] != (char) (i + 11)
+        || rodata[i * PAGE_SIZE + 1] != 0 || data[i * PAGE_SIZE + 1] != 0)
+      fail ("page %zu has the wrong data", i);
+  CHECK (sum == 36 + 116, "data is intact");
+
+  for (i = 0; i < DATA_PAGES; i++)
+    data[i * PAGE_SIZE] = 0x5a;
+  for (i = 0; i < DATA_PAGES; i++)
+    if (data[i * PAGE_SIZE] != 0x5a)
+      fail ("page %zu was not written", i);
+  msg ("data is writable");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(load-eager) begin
+(load-eager) memstat
+(load-eager) memstat after reading the data
+(load-eager) data was resident
+(load-eager) data is intact
+(load-eager) data is writable
+(load-eager) end
+load-eager: exit(0)
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Gives the VM advice on a memory-mapped file and on anonymous
+   memory.  Pages read in ahead must hold the file's data, dropped
+   anonymous pages must read back as zeros, and bad ranges or advice
+   must be refused. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (8 * PAGE_SIZE)
+
+static char buf[SIZE + PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char *anon = (char *) ROUND_UP ((uintptr_t) buf, PAGE_SIZE);
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+
+  CHECK (madvise (actual, PAGE_SIZE, MADV_WILLNEED) == 0,
+         "madvise willneed");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  CHECK (madvise (actual, PAGE_SIZE, MADV_SEQUENTIAL) == 0,
+         "madvise sequential");
+  CHECK (madvise (actual, PAGE_SIZE, MADV_RANDOM) == 0, "madvise random");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+
+  memset (anon, 0x5a, SIZE);
+  CHECK (madvise (anon, SIZE, MADV_DONTNEED) == 0, "madvise dontneed");
+  for (i = 0; i < SIZE; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu of dropped page has value %02hhx (should be 0)",
+            i, anon[i]);
+  msg ("dropped pages read back as zeros");
+
+  CHECK (madvise (anon + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise misaligned address");
+  CHECK (madvise ((char *) 0x20000000, PAGE_SIZE, MADV_WILLNEED) == -1,
+         "madvise unmapped range");
+  CHECK (madvise (anon, PAGE_SIZE, 99) == -1, "madvise bad advice");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) madvise willneed
+(madvise) madvise sequential
+(madvise) madvise random
+(madvise) madvise dontneed
+(madvise) dropped pages read back as zeros
+(madvise) madvise misaligned address
+(madvise) madvise unmapped range
+(madvise) madvise bad advice
+(madvise) end
+EOF
+pass;
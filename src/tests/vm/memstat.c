@@ -0,0 +1,47 @@
+/* Checks that memstat() counts the pages a process touches and the
+   pages it locks, and reports no resident-set cap by default. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define TOUCH_PAGES 32
+#define LOCK_PAGES 4
+
+static char buf[(TOUCH_PAGES + 1) * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *anon = (char *) ROUND_UP ((uintptr_t) buf, PAGE_SIZE);
+  struct memstat before, after;
+  size_t i;
+
+  CHECK (memstat (&before), "memstat");
+  if (before.rss == 0)
+    fail ("no resident pages reported");
+  if (before.rss_max != 0)
+    fail ("resident-set cap is %zu (should be 0)", before.rss_max);
+  if (before.pinned != 0)
+    fail ("%zu pinned pages reported (should be 0)", before.pinned);
+
+  for (i = 0; i < TOUCH_PAGES; i++)
+    anon[i * PAGE_SIZE] = 1;
+  CHECK (memstat (&after), "memstat after touching pages");
+  if (after.rss < before.rss + TOUCH_PAGES)
+    fail ("resident pages went from %zu to %zu after touching %d pages",
+          before.rss, after.rss, TOUCH_PAGES);
+  msg ("touched pages are resident");
+
+  CHECK (mlock (anon, LOCK_PAGES * PAGE_SIZE) == 0, "mlock");
+  CHECK (memstat (&after), "memstat after mlock");
+  if (after.pinned != LOCK_PAGES)
+    fail ("%zu pinned pages reported (should be %d)",
+          after.pinned, LOCK_PAGES);
+  msg ("locked pages are pinned");
+  CHECK (munlock (anon, LOCK_PAGES * PAGE_SIZE) == 0, "munlock");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(memstat) begin
+(memstat) memstat
+(memstat) memstat after touching pages
+(memstat) touched pages are resident
+(memstat) mlock
+(memstat) memstat after mlock
+(memstat) locked pages are pinned
+(memstat) munlock
+(memstat) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Locks anonymous pages in memory and checks that they keep their
+   contents, cannot be dropped with madvise(), and that a process
+   cannot lock more than the default limit of 64 pages. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define LOCK_SIZE (8 * PAGE_SIZE)
+#define SIZE (72 * PAGE_SIZE)
+
+static char buf[SIZE + PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *anon = (char *) ROUND_UP ((uintptr_t) buf, PAGE_SIZE);
+  size_t i;
+
+  CHECK (mlock (anon, LOCK_SIZE) == 0, "mlock");
+  memset (anon, 0x5a, LOCK_SIZE);
+  for (i = 0; i < LOCK_SIZE; i++)
+    if (anon[i] != 0x5a)
+      fail ("byte %zu of locked page has value %02hhx (should be 5a)",
+            i, anon[i]);
+  msg ("locked pages hold their data");
+
+  CHECK (madvise (anon, LOCK_SIZE, MADV_DONTNEED) == -1,
+         "madvise dontneed on locked pages");
+  CHECK (mlock (anon + 1, PAGE_SIZE) == -1, "mlock misaligned address");
+  CHECK (mlock (anon, SIZE) == -1, "mlock over the limit");
+  CHECK (munlock (anon, LOCK_SIZE) == 0, "munlock");
+  CHECK (madvise (anon, LOCK_SIZE, MADV_DONTNEED) == 0,
+         "madvise dontneed on unlocked pages");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) mlock
+(mlock) locked pages hold their data
+(mlock) madvise dontneed on locked pages
+(mlock) mlock misaligned address
+(mlock) mlock over the limit
+(mlock) munlock
+(mlock) madvise dontneed on unlocked pages
+(mlock) end
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Writes to a file through a mapping and checkpoints it with
+   msync(), reading the file back with the read system call while
+   it is still mapped.  The file spans a partial last page, which
+   must not grow the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define PAGE_SIZE 4096
+#define SIZE (3 * PAGE_SIZE + 100)
+
+static char buf[SIZE];
+
+/* Reads the whole file in HANDLE and compares it with the mapping. */
+static void
+compare_file (int handle, const char *what)
+{
+  seek (handle, 0);
+  if (read (handle, buf, SIZE) != SIZE)
+    fail ("read \"data\"");
+  CHECK (!memcmp (buf, ACTUAL, SIZE), "compare file against %s", what);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"data\"");
+
+  for (i = 0; i < SIZE; i++)
+    ACTUAL[i] = i % 251;
+  CHECK (msync (ACTUAL, SIZE, MS_SYNC) == 0, "msync");
+  compare_file (handle, "synced mapping");
+
+  memset (ACTUAL + PAGE_SIZE, 0x5a, PAGE_SIZE);
+  CHECK (msync (ACTUAL + PAGE_SIZE, PAGE_SIZE, MS_SYNC) == 0,
+         "msync one page");
+  compare_file (handle, "synced page");
+
+  memset (ACTUAL, 0xa5, 10);
+  CHECK (msync (ACTUAL, PAGE_SIZE, MS_ASYNC) == 0, "msync async");
+  CHECK (msync (ACTUAL, PAGE_SIZE, MS_ASYNC | MS_SYNC) == -1,
+         "msync bad flags");
+  CHECK (msync ((char *) 0x20000000, PAGE_SIZE, MS_SYNC) == -1,
+         "msync unmapped range");
+
+  munmap (map);
+  CHECK (filesize (handle) == SIZE, "file size unchanged");
+  seek (handle, 0);
+  if (read (handle, buf, 10) != 10)
+    fail ("read \"data\"");
+  for (i = 0; i < 10; i++)
+    if ((unsigned char) buf[i] != 0xa5)
+      fail ("byte %zu of file is %02hhx (should be a5)", i, buf[i]);
+  msg ("munmap wrote back the rest");
+  close (handle);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync) begin
+(msync) create "data"
+(msync) open "data"
+(msync) mmap "data"
+(msync) msync
+(msync) compare file against synced mapping
+(msync) msync one page
+(msync) compare file against synced page
+(msync) msync async
+(msync) msync bad flags
+(msync) msync unmapped range
+(msync) file size unchanged
+(msync) munmap wrote back the rest
+(msync) end
+EOF
+pass;
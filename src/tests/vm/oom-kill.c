@@ -0,0 +1,23 @@
+/* Runs child-hog, which takes most of memory and swap and then only
+   spins, and once it is ready runs child-linear, which needs more
+   memory than is left.  The OOM killer has to kill child-hog, which
+   is not the process faulting, to let child-linear finish. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t hog, child;
+  int fd;
+
+  CHECK ((hog = exec ("child-hog")) != -1, "exec \"child-hog\"");
+  while ((fd = open ("hog-ready")) == -1)
+    continue;
+  close (fd);
+  CHECK ((child = exec ("child-linear")) != -1, "exec \"child-linear\"");
+  CHECK (wait (child) == 0x42, "wait for child-linear");
+  CHECK (wait (hog) == -1, "wait for child-hog, killed");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_OOM_KILLS => 1, [<<'EOF']);
+(oom-kill) begin
+(oom-kill) exec "child-hog"
+(oom-kill) exec "child-linear"
+(oom-kill) wait for child-linear
+(oom-kill) wait for child-hog, killed
+(oom-kill) end
+EOF
+pass;
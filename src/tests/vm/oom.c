@@ -0,0 +1,18 @@
+/* Runs a child that touches more memory than there is, frames and
+   swap together, and checks that it is killed.  Then checks that its
+   memory is back by running child-linear. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  CHECK ((child = exec ("child-oom")) != -1, "exec \"child-oom\"");
+  CHECK (wait (child) == -1, "wait for child-oom, killed");
+  CHECK ((child = exec ("child-linear")) != -1, "exec \"child-linear\"");
+  CHECK (wait (child) == 0x42, "wait for child-linear");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, IGNORE_OOM_KILLS => 1, [<<'EOF']);
+(oom) begin
+(oom) exec "child-oom"
+(oom) wait for child-oom, killed
+(oom) exec "child-linear"
+(oom) wait for child-linear
+(oom) end
+EOF
+pass;
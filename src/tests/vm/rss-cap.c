@@ -0,0 +1,38 @@
+/* Runs with a resident-set cap of 16 pages and writes 64 pages,
+   checking that they keep their contents while the process stays
+   within its cap. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 64
+
+static char buf[(PAGES + 1) * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *anon = (char *) ROUND_UP ((uintptr_t) buf, PAGE_SIZE);
+  struct memstat ms;
+  size_t i;
+
+  for (i = 0; i < PAGES; i++)
+    memset (anon + i * PAGE_SIZE, i, PAGE_SIZE);
+  for (i = 0; i < PAGES * PAGE_SIZE; i++)
+    if (anon[i] != (char) (i / PAGE_SIZE))
+      fail ("byte %zu has value %02hhx (should be %02zx)",
+            i, anon[i], i / PAGE_SIZE);
+  msg ("pages hold their data");
+
+  CHECK (memstat (&ms), "memstat");
+  if (ms.rss_max != 16)
+    fail ("resident-set cap is %zu (should be 16)", ms.rss_max);
+  if (ms.rss > ms.rss_max)
+    fail ("%zu resident pages over a cap of %zu", ms.rss, ms.rss_max);
+  msg ("resident set within its cap");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-cap) begin
+(rss-cap) pages hold their data
+(rss-cap) memstat
+(rss-cap) resident set within its cap
+(rss-cap) end
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Runs child-linear 16 times in a row with a small user pool, so that
+   each child swaps more than 100 pages.  Together they need several
+   times the swap device, so this only passes if each child's swap
+   slots are freed when it exits. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 16
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t child = exec ("child-linear");
+      if (child == -1)
+        fail ("exec \"child-linear\" %d", i);
+      if (wait (child) != 0x42)
+        fail ("wait for child %d", i);
+    }
+  msg ("ran %d children", CHILD_CNT);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-churn) begin
+(swap-churn) ran 16 children
+(swap-churn) end
+EOF
+pass;
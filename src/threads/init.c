@@ -38,11 +38,21 @@
 #include "filesys/fsutil.h"
 #endif
 #include "vm/frame.h"
+#include "vm/oom.h"
+#include "vm/page.h"
+#include "vm/spt.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* True if 4 MB pages are enabled (CR4.PSE). */
+bool pse_enabled;
+
+#define CPUID_PSE 0x00000008    /* CPUID 1, EDX: 4 MB pages supported. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -56,6 +66,20 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
+#ifdef VM
+/* -clean-low, -clean-high: Free frame watermarks for the page
+   cleaner, SIZE_MAX to size them from the frame table. */
+static size_t clean_low_watermark = SIZE_MAX;
+static size_t clean_high_watermark = SIZE_MAX;
+
+/* -merge: Milliseconds between same-page merging scans, 0 to not
+   merge pages. */
+static int merge_interval;
+
+/* -wss: Milliseconds between working-set scans, 0 for none. */
+static int wss_interval = 1000;
+#endif
+
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
@@ -131,7 +155,16 @@ main (void)
 
   /* P3 Update - initialize frame table */
   frame_table_init ();
+  oom_init ();
   swap_init ();
+  page_init ();
+#ifdef VM
+  frame_cleaner_init (clean_low_watermark, clean_high_watermark);
+  if (merge_interval > 0)
+    frame_merger_init (merge_interval);
+  if (wss_interval > 0)
+    frame_wss_init (wss_interval);
+#endif
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -155,10 +188,27 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Returns true if the CPU supports 4 MB pages, as reported by
+   CPUID.  See [IA32-v2a] "CPUID--CPU Identification". */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each 4 MB of RAM not holding kernel
+   text is mapped with one large page instead of a page table,
+   which saves the page tables and leaves the TLB entries for
+   user pages.  Kernel text stays in 4 kB pages to be mapped
+   read-only on its own. */
 static void
 paging_init (void)
 {
@@ -166,6 +216,15 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
+  pse_enabled = cpu_has_pse ();
+  if (pse_enabled)
+    {
+      /* See [IA32-v3a] 2.5 "Control Registers". */
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -176,6 +235,16 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse_enabled && pte_idx == 0 
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          /* A whole 4 MB of RAM without kernel text. */
+          pd[pde_idx] = pde_create_large (vaddr, true, false);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -255,6 +324,35 @@ parse_options (char **argv)
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-evict"))
+        {
+          if (value != NULL && !strcmp (value, "clock"))
+            frame_evict_policy = EVICT_CLOCK;
+          else if (value != NULL && !strcmp (value, "wsclock"))
+            frame_evict_policy = EVICT_WSCLOCK;
+          else
+            PANIC ("unknown eviction policy `%s' (use -h for help)", value);
+        }
+      else if (!strcmp (name, "-clean-low"))
+        clean_low_watermark = atoi (value);
+      else if (!strcmp (name, "-clean-high"))
+        clean_high_watermark = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-merge"))
+        merge_interval = value != NULL ? atoi (value) : 1000;
+      else if (!strcmp (name, "-mlock"))
+        page_mlock_max = atoi (value);
+      else if (!strcmp (name, "-rss"))
+        page_rss_max = atoi (value);
+      else if (!strcmp (name, "-wss"))
+        wss_interval = atoi (value);
+      else if (!strcmp (name, "-around"))
+        page_fault_around = atoi (value);
+      else if (!strcmp (name, "-large"))
+        page_large = true;
+      else if (!strcmp (name, "-eager"))
+        page_eager_max = atoi (value);
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
@@ -320,6 +418,9 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+#endif
+#ifdef VM
+      {"spt-bench", 1, spt_bench},
 #endif
       {NULL, 0, NULL},
     };
@@ -369,6 +470,9 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+#endif
+#ifdef VM
+          "  spt-bench          Benchmark the supplemental page table.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -380,6 +484,17 @@ usage (void)
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -evict=POLICY      Evict pages by clock (default) or wsclock.\n"
+          "  -clean-low=COUNT   Start cleaning pages below COUNT free frames.\n"
+          "  -clean-high=COUNT  Stop cleaning at COUNT free or clean frames.\n"
+          "  -zswap=PAGES       Keep compressed swap in PAGES pages (32).\n"
+          "  -merge[=MS]        Merge identical pages every MS ms (1000).\n"
+          "  -mlock=PAGES       Let a process mlock up to PAGES pages (64).\n"
+          "  -rss=PAGES         Cap each process at PAGES resident pages.\n"
+          "  -wss=MS            Estimate working sets every MS ms (1000).\n"
+          "  -around=PAGES      Map resident pages around faults (16).\n"
+          "  -large             Map big zero-filled regions with 4 MB pages.\n"
+          "  -eager=PAGES       Load programs up to PAGES long at exec (0).\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
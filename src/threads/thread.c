@@ -508,10 +508,21 @@ init_thread (struct thread *t, const char *name, int priority)
   t->file_exec = false;
   list_init (&t->opened_files);
   list_init (&t->file_maps);
+  list_init (&t->regions);
 
   /* P3 Update initialize pages in threds*/
   t->sup_page_table = NULL;
   t->user_esp = NULL;
+  t->heap_start = NULL;
+  t->brk = NULL;
+  t->pinned_cnt = 0;
+  t->rss = 0;
+  t->rss_max = 0;
+  t->wss = 0;
+  t->wss_next = 0;
+  t->swap_cnt = 0;
+  t->oom_killed = false;
+  t->in_syscall = true;
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
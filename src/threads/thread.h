@@ -119,10 +119,28 @@ struct thread
                                            executables */
    
     /* P3 update*/
-    struct hash *sup_page_table;        /* Hash table to keep track of pages 
-                                           belong to thread. */
+    struct sup_page_table *sup_page_table; /* Keeps track of pages 
+                                              belong to thread. */
     void *user_esp;                     /* Stack pointer. */
     struct list file_maps;               /* Memory-mapped files. */
+    struct list regions;                /* Mapped address ranges. */
+    uint8_t *heap_start;                /* First page of the heap, after 
+                                           the loaded segments. */
+    uint8_t *brk;                       /* Program break, end of the 
+                                           heap. */
+    size_t pinned_cnt;                  /* Pages locked by mlock (). */
+    size_t rss;                         /* Pages in frames. */
+    size_t rss_max;                     /* Most pages in frames before 
+                                           evicting its own, or 0. */
+    size_t wss;                         /* Pages used during the last 
+                                           working-set scan interval. */
+    size_t wss_next;                    /* Same, for the current one. */
+    size_t swap_cnt;                    /* Pages holding a swap slot. */
+    bool oom_killed;                    /* Killed by the OOM killer. */
+    bool in_syscall;                    /* In a system call, a page 
+                                           fault or loading, the kernel 
+                                           may be using user pages it 
+                                           has not locked. */
    /* P3 update timer */
     int64_t wakeup_time;                /* Thread wake up time. */
     struct list_elem sleepelem;         /* List element for sleeping
@@ -153,13 +153,33 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* Keep the OOM killer off this process's pages while in here, as in 
+     a system call, and let a process it killed die at its next 
+     fault. */
+  if (user)
+    {
+      thread_current ()->in_syscall = true;
+      if (thread_current ()->oom_killed)
+        handle_exit (-1);
+    }
+
+  /* A write to a page shared copy-on-write after fork, by the user or 
+     by the kernel on its behalf. */
+  if (!not_present && write && page_cow (fault_addr))
+    {
+      if (user)
+        thread_current ()->in_syscall = false;
+      return;
+    }
+
   /* P3 Update */
   /* Lazing loading for other pages in user thread if address is valid */
   if (user && not_present)
     {
-      if (!page_load (fault_addr))
+      if (!page_load (fault_addr, write))
          /* If load fails, exit the thread */
         thread_exit ();
+      thread_current ()->in_syscall = false;
       return;
     }
 
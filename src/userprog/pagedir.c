@@ -3,11 +3,25 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Large pages split into page tables. */
+long long pagedir_split_cnt;
+
+/* Page tables freed once all of their pages were unmapped. */
+long long pagedir_reclaim_cnt;
+
+/* Page tables set aside for splitting large pages, one for each
+   large page mapped, so that splitting one never fails.  Linked
+   through their first word. */
+static uint32_t *spare_pts;
+
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+static uint32_t *spare_pop (void);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -34,18 +48,99 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if (*pde & PTE_PS)
+      /* A large page has a page table set aside instead. */
+      palloc_free_page (spare_pop ());
+    else if (*pde & PTE_P) 
     /* If the page is in memory, free it. */
       palloc_free_page (pde_get_pt (*pde));
   palloc_free_page (pd);
 }
 
+/* Adds page table PT to the spare page tables. */
+static void
+spare_push (uint32_t *pt)
+{
+  enum intr_level old_level = intr_disable ();
+  *(uint32_t **) pt = spare_pts;
+  spare_pts = pt;
+  intr_set_level (old_level);
+}
+
+/* Takes a page table off the spare page tables, which must not
+   be empty. */
+static uint32_t *
+spare_pop (void)
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pt = spare_pts;
+  ASSERT (pt != NULL);
+  spare_pts = *(uint32_t **) pt;
+  intr_set_level (old_level);
+  return pt;
+}
+
+/* Returns the PDE for user virtual address VADDR in PD if it
+   maps a large page, otherwise a null pointer. */
+static uint32_t *
+lookup_large (uint32_t *pd, const void *vaddr)
+{
+  uint32_t *pde = pd + pd_no (vaddr);
+  return (*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS) ? pde : NULL;
+}
+
+/* Returns the first user virtual address covered by PDE in PD. */
+static void *
+pt_base (uint32_t *pd, uint32_t *pde)
+{
+  return (void *) ((uintptr_t) (pde - pd) << PDSHIFT);
+}
+
+/* Replaces large page PDE in PD by one of the spare page tables,
+   filled in to map the same memory with 4 kB pages that have the
+   large page's flags.  The pages can then be changed one by
+   one. */
+static void
+split_large (uint32_t *pd, uint32_t *pde)
+{
+  uint32_t *pt = spare_pop ();
+  uint32_t paddr = *pde & ~(uint32_t) (PTSPAN - 1);
+  uint32_t flags = *pde & PTE_FLAGS & ~(uint32_t) PTE_PS;
+  size_t i;
+
+  for (i = 0; i < 1 << PTBITS; i++)
+    pt[i] = (paddr + i * PGSIZE) | flags;
+  *pde = pde_create (pt);
+  invalidate_page (pd, pt_base (pd, pde));
+  pagedir_split_cnt++;
+}
+
+/* Frees the page table of PDE in PD if none of its entries maps a
+   page or keeps a dirty bit.  The caller has interrupts off. */
+static void
+reclaim_pt (uint32_t *pd, uint32_t *pde)
+{
+  uint32_t *pt = pde_get_pt (*pde);
+  size_t i;
+
+  for (i = 0; i < 1 << PTBITS; i++)
+    if (pt[i] & (PTE_P | PTE_D))
+      return;
+  *pde = 0;
+  invalidate_page (pd, pt_base (pd, pde));
+  palloc_free_page (pt);
+  pagedir_reclaim_cnt++;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   A large page at VADDR is split into 4 kB pages first.
+   The caller must have interrupts off, so that the page table
+   returned into is not reclaimed meanwhile. */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -67,11 +162,21 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
           if (pt == NULL) 
             return NULL; 
       
-          *pde = pde_create (pt);
+          if (*pde == 0)
+            *pde = pde_create (pt);
+          else
+            {
+              /* Another thread put a page table there while
+                 palloc_get_page() slept. */
+              palloc_free_page (pt);
+              return lookup_page (pd, vaddr, create);
+            }
         }
       else
         return NULL;
     }
+  else if (*pde & PTE_PS)
+    split_large (pd, pde);
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -91,6 +196,7 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
 bool
 pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 {
+  enum intr_level old_level;
   uint32_t *pte;
 
   ASSERT (pg_ofs (upage) == 0);
@@ -99,16 +205,58 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
   ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
   ASSERT (pd != init_page_dir);
 
+  old_level = intr_disable ();
   pte = lookup_page (pd, upage, true);
-
   if (pte != NULL) 
     {
       ASSERT ((*pte & PTE_P) == 0);
       *pte = pte_create_user (kpage, writable);
-      return true;
     }
-  else
+  intr_set_level (old_level);
+  return pte != NULL;
+}
+
+/* Maps the PTSPAN bytes of user virtual memory starting at UPAGE
+   in page directory PD to the physically contiguous frames
+   starting at kernel virtual address KPAGE, with one large page.
+   Both must be aligned to PTSPAN, and PD must have no page table
+   for UPAGE yet.  If WRITABLE is true the memory is read/write,
+   otherwise it is read-only.
+   The large page has a single accessed and a single dirty bit
+   for all of its 4 kB pages.  It is split into 4 kB pages as
+   soon as one of them is unmapped or has its dirty or writable
+   bit changed.
+   Returns false if 4 MB pages are not enabled, if PD already has
+   a page table there, or if memory allocation failed. */
+bool
+pagedir_set_large (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pde = pd + pd_no (upage);
+  enum intr_level old_level;
+  uint32_t *pt;
+  bool success;
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (pd != init_page_dir);
+
+  if (!pse_enabled || *pde != 0)
+    return false;
+  pt = palloc_get_page (0);
+  if (pt == NULL)
     return false;
+
+  old_level = intr_disable ();
+  success = *pde == 0;
+  if (success)
+    {
+      spare_push (pt);
+      *pde = pde_create_large (kpage, writable, true);
+    }
+  intr_set_level (old_level);
+  if (!success)
+    palloc_free_page (pt);
+  return success;
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -118,35 +266,102 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 void *
 pagedir_get_page (uint32_t *pd, const void *uaddr) 
 {
+  enum intr_level old_level;
   uint32_t *pte;
+  void *kaddr = NULL;
 
   ASSERT (is_user_vaddr (uaddr));
-  
-  pte = lookup_page (pd, uaddr, false);
-  if (pte != NULL && (*pte & PTE_P) != 0)
-    return pte_get_page (*pte) + pg_ofs (uaddr);
+
+  old_level = intr_disable ();
+  pte = lookup_large (pd, uaddr);
+  if (pte != NULL)
+    kaddr = ptov (*pte & ~(uint32_t) (PTSPAN - 1)) 
+            + ((uintptr_t) uaddr & (PTSPAN - 1));
   else
-    return NULL;
+    {
+      pte = lookup_page (pd, uaddr, false);
+      if (pte != NULL && (*pte & PTE_P) != 0)
+        kaddr = pte_get_page (*pte) + pg_ofs (uaddr);
+    }
+  intr_set_level (old_level);
+  return kaddr;
 }
 
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
-   bits in the page table entry are preserved.
+   bits in the page table entry are preserved, but a page table
+   left with no present or dirty entries is freed.
    UPAGE need not be mapped. */
 void
 pagedir_clear_page (uint32_t *pd, void *upage) 
 {
+  enum intr_level old_level;
   uint32_t *pte;
 
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (is_user_vaddr (upage));
 
+  old_level = intr_disable ();
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
+      if ((*pte & PTE_D) == 0)
+        reclaim_pt (pd, pd + pd_no (upage));
     }
+  intr_set_level (old_level);
+}
+
+/* Unmaps the user virtual pages from START up to END in page
+   directory PD, for pages that are going away: unlike
+   pagedir_clear_page(), their entries are zeroed, dirty bits and
+   all.  Page tables left empty are freed.  The TLB is flushed
+   once at the end instead of once per page. */
+void
+pagedir_clear_range (uint32_t *pd, void *start, void *end)
+{
+  enum intr_level old_level;
+  uint8_t *upage = start;
+  bool flush = false;
+
+  ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+  ASSERT (start <= end && end <= PHYS_BASE);
+
+  old_level = intr_disable ();
+  while (upage < (uint8_t *) end)
+    {
+      uint32_t *pde = pd + pd_no (upage);
+      uint8_t *next = (uint8_t *) pt_base (pd, pde) + PTSPAN;
+      uint32_t *pt;
+
+      if (next > (uint8_t *) end)
+        next = end;
+      if ((*pde & PTE_PS) && upage == pt_base (pd, pde) 
+          && next == upage + PTSPAN)
+        {
+          /* A whole large page. */
+          *pde = 0;
+          palloc_free_page (spare_pop ());
+          flush = true;
+        }
+      else if (*pde != 0)
+        {
+          if (*pde & PTE_PS)
+            split_large (pd, pde);
+          pt = pde_get_pt (*pde);
+          for (; upage < next; upage += PGSIZE)
+            {
+              flush = flush || (pt[pt_no (upage)] & PTE_P) != 0;
+              pt[pt_no (upage)] = 0;
+            }
+          reclaim_pt (pd, pde);
+        }
+      upage = next;
+    }
+  if (flush)
+    invalidate_pagedir (pd);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
@@ -156,26 +371,41 @@ pagedir_clear_page (uint32_t *pd, void *upage)
 bool
 pagedir_is_dirty (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
-  return pte != NULL && (*pte & PTE_D) != 0;
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pte = lookup_large (pd, vpage);
+  bool dirty;
+
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
+  dirty = pte != NULL && (*pte & PTE_D) != 0;
+  intr_set_level (old_level);
+  return dirty;
 }
 
 /* Set the dirty bit to DIRTY in the PTE for virtual page VPAGE
-   in PD. */
+   in PD.  Clearing it on a page that is no longer mapped lets its 
+   page table be freed once empty. */
 void
 pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty) 
 {
+  enum intr_level old_level = intr_disable ();
   uint32_t *pte = lookup_page (pd, vpage, false);
   if (pte != NULL) 
     {
       if (dirty)
         *pte |= PTE_D;
-      else 
+      else if ((*pte & PTE_P) != 0)
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
+        }
+      else
+        {
+          *pte &= ~(uint32_t) PTE_D;
+          reclaim_pt (pd, pd + pd_no (vpage));
         }
     }
+  intr_set_level (old_level);
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PD has been
@@ -185,16 +415,27 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
 bool
 pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
-  return pte != NULL && (*pte & PTE_A) != 0;
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pte = lookup_large (pd, vpage);
+  bool accessed;
+
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
+  accessed = pte != NULL && (*pte & PTE_A) != 0;
+  intr_set_level (old_level);
+  return accessed;
 }
 
 /* Sets the accessed bit to ACCESSED in the PTE for virtual page
-   VPAGE in PD. */
+   VPAGE in PD.  In a large page, that is the bit shared by all of
+   its pages. */
 void
 pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   if (pte != NULL) 
     {
       if (accessed)
@@ -202,9 +443,28 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
+  intr_set_level (old_level);
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  The accessed and dirty bits are preserved. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_page (pd, vpage);
+    }
+  intr_set_level (old_level);
 }
 
 /* Loads page directory PD into the CPU's page directory base
@@ -254,3 +514,15 @@ invalidate_pagedir (uint32_t *pd)
       pagedir_activate (pd);
     } 
 }
+
+/* Invalidates only the TLB entry for user virtual address VADDR,
+   if PD is the active page directory, leaving the TLB entries of
+   other pages in place.  Also drops cached page directory
+   entries, so it covers a freed page table or a large page as
+   well.  See [IA32-v2a] "INVLPG--Invalidate TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vaddr)
+{
+  if (active_pd () == pd)
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
@@ -21,8 +21,11 @@
 #include "userprog/syscall.h"
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/region.h"
+#include "vm/spt.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
 /* Starts a new thread running a user program loaded from
@@ -102,6 +105,86 @@ start_process (void *file_name_)
      arguments on the stack in the form of a `struct intr_frame',
      we just point the stack pointer (%esp) to our stack frame
      and jump to it. */
+  thread_current ()->in_syscall = false;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* What a process being forked needs from its parent. */
+struct fork_info
+  {
+    struct thread *parent;              /* Process being cloned. */
+    struct intr_frame if_;              /* Parent's user registers. */
+  };
+
+/* Starts a new process that is a copy of the current one, which
+   entered the kernel with the user registers in IF_.  The child
+   shares the parent's resident pages copy-on-write, so nothing is
+   read from the executable.  Returns the child's thread id to the
+   parent, or TID_ERROR if the child cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct thread *cur = thread_current ();
+  struct fork_info fork;
+  tid_t tid;
+
+  fork.parent = cur;
+  fork.if_ = *if_;
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &fork);
+
+  /* Push the new thread to current thread's children list and wait 
+     until it is done copying, FORK lives on this stack. */
+  struct thread *child = get_thread (tid);
+  if (child != NULL) 
+    {
+      list_push_back (&cur->children, &child->childelem);
+      sema_down (&child->load_lock);
+      if (child->load_status == -1)
+        tid = TID_ERROR;
+    }
+
+  return tid;
+}
+
+/* A thread function that copies the parent's address space and
+   open files, then returns to user mode where the parent made
+   the fork system call, with 0 as the return value. */
+static void
+start_fork (void *fork_)
+{
+  struct fork_info *fork = fork_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = fork->if_;
+  bool success = false;
+
+  cur->user_esp = fork->parent->user_esp;
+  cur->heap_start = fork->parent->heap_start;
+  cur->brk = fork->parent->brk;
+  cur->rss_max = fork->parent->rss_max;
+  cur->pagedir = pagedir_create ();
+  if (cur->pagedir != NULL)
+    {
+      process_activate ();
+      cur->sup_page_table = spt_create ();
+      if (cur->sup_page_table != NULL)
+        {
+          success = files_fork (fork->parent) 
+                    && region_fork (fork->parent) 
+                    && page_fork (fork->parent);
+        }
+    }
+
+  /* The parent may go on once the load status is known. */
+  if (!success)
+    cur->load_status = -1;
+  sema_up (&cur->load_lock);
+  if (!success) 
+    thread_exit ();
+
+  /* Return to user mode as start_process () does. */
+  if_.eax = 0;
+  cur->in_syscall = false;
   asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
   NOT_REACHED ();
 }
@@ -167,6 +250,12 @@ process_exit (void)
   /* print exit status code */
   printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
 
+  /* P3 update - free all pages of the current thread, and their swap 
+     slots, now rather than once the parent reaps us, which may be 
+     never. */
+  page_exit ();
+  region_exit ();
+
   /* before exit, unblock the parent thread waiting for this child process */
   sema_up (&(cur->wait_lock));
   
@@ -181,8 +270,6 @@ process_exit (void)
     }
 
   sema_down (&(cur->exit_lock));
-  /* P3 update - free all pages of the current thread. */
-  page_exit ();
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -309,11 +396,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  /* P3 update - Allocate and activate initial page hash table for thread. */
-  t->sup_page_table = malloc (sizeof *t->sup_page_table);
+  /* P3 update - Allocate initial supplemental page table for thread. */
+  t->sup_page_table = spt_create ();
   if (t->sup_page_table == NULL)
     goto done;
-  hash_init (t->sup_page_table, page_get_hash, page_less, NULL);
+  t->rss_max = page_rss_max;
 
   /* P2 update - extract file name */
   char *save_ptr;
@@ -405,6 +492,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+              /* The heap starts after the last segment. */
+              if ((uint8_t *) mem_page + read_bytes + zero_bytes 
+                  > t->heap_start)
+                t->heap_start = t->brk = (uint8_t *) mem_page + read_bytes 
+                                         + zero_bytes;
             }
           else
             goto done;
@@ -497,32 +589,18 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  while (read_bytes > 0 || zero_bytes > 0) 
-    {
-      /* Calculate how to fill this page.
-         We will read PAGE_READ_BYTES bytes from FILE
-         and zero the final PAGE_ZERO_BYTES bytes. */
-      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-      size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-      /* P3 Update - Add user vitual address to page hash table, wait to be 
-         map to physical address*/
-      struct page *p = page_allocation (upage, !writable);
-      if (p == NULL)
-        return false;
-      if (page_read_bytes > 0) 
-        {
-          p->file = file;
-          p->file_offset = ofs;
-          p->file_bytes = page_read_bytes;
-        }
-      read_bytes -= page_read_bytes;
-      zero_bytes -= page_zero_bytes;
+  /* Map the whole segment as one region, its pages are created on 
+     their first use. */
+  if (!region_add (upage, read_bytes + zero_bytes, 
+                   read_bytes > 0 ? file : NULL, ofs, read_bytes, 
+                   !writable, writable))
+    return false;
 
-      /* P3 Update - offset correction */
-      ofs += page_read_bytes;
-      upage += PGSIZE;
-    }
+  /* A small program's file pages are read in right away, with a few 
+     big reads instead of a fault and a read for each page. */
+  if (read_bytes > 0 && page_eager_max > 0
+      && (size_t) file_length (file) <= page_eager_max * PGSIZE)
+    page_load_eager (upage, read_bytes);
   return true;
 }
 
@@ -14,7 +14,9 @@
 #include "devices/input.h"
 #include "threads/malloc.h"
 #include <string.h>
+#include <round.h>
 #include "vm/page.h"
+#include "vm/region.h"
 #include "threads/palloc.h"
 #include "devices/timer.h"
 
@@ -73,8 +75,10 @@ valid_check (const void *usrc_, size_t size)
             return false;
         }
       
-      /* Map the page to kernal address */
-      if (page->frame == NULL && !page_load_helper (page))
+      /* Map the page to kernal address.  A page read ahead from its file 
+         has a frame but no mapping yet. */
+      if (pagedir_get_page (thread_current ()->pagedir, usrc) == NULL 
+          && !page_load_helper (page))
         return false;
     }
 
@@ -396,34 +400,25 @@ handle_mmap (int fd, void *addr)
       return -1;
     }
 
-  list_push_front (&thread_current ()->file_maps, &map->elem);
   map->vaddr = addr;
-  map->page_num = 0;
-  off_t offset = 0;
   lock_acquire (&filesys_lock);
   off_t file_len = file_length (map->file);
   lock_release (&filesys_lock);
-  while (file_len > 0)
+  map->page_num = DIV_ROUND_UP (file_len, PGSIZE);
+
+  /* Map the file as one region, its pages are created on their first 
+     use. */
+  if (file_len > 0 
+      && !region_add (addr, file_len, map->file, 0, file_len, false, false))
     {
-      struct page *p = page_allocation ((uint8_t *) addr + offset, false);
-      if (p == NULL)
-        {
-          /* If page allocation failed, unmap as some pages may be already 
-             allocated, and return -1 */
-          handle_munmap (fd);
-          return -1;
-        }
-      p->private = false;
-      p->file = map->file;
-      p->file_offset = offset;
-      if (file_len >= PGSIZE)
-        p->file_bytes = PGSIZE;
-      else
-        p->file_bytes = file_len;
-      offset += p->file_bytes;
-      file_len -= p->file_bytes;
-      map->page_num++;
+      /* Overlaps memory already in use, or out of memory. */
+      lock_acquire (&filesys_lock);
+      file_close (map->file);
+      lock_release (&filesys_lock);
+      free (map);
+      return -1;
     }
+  list_push_front (&thread_current ()->file_maps, &map->elem);
   return map->fd;
 }
 
@@ -439,32 +434,191 @@ handle_munmap (mapid_t mapping)
        e = list_next (e))
     {
       /* find the file map with mapping id = mapping. */
-      map = list_entry (e, struct file_map, elem);
-      if (map->fd == mapping)
-        break;
+      struct file_map *m = list_entry (e, struct file_map, elem);
+      if (m->fd == mapping)
+        {
+          map = m;
+          break;
+        }
     }
   if (map == NULL)
     /* if the file map is not found, exit. */
     thread_exit ();
-  /* Remove the file map from the file map list. */
+  /* Remove the file map from the file map list, and its region so that 
+     no more pages are created in it. */
   list_remove (&map->elem);
-  for(int i = 0; i < map->page_num; i++)
+  region_remove (map->vaddr);
+
+  /* Write the dirty pages back to the file as msync () does, unmap 
+     them all with one TLB flush, then remove every page from the 
+     supplemental page table. */
+  page_sync (map->vaddr, map->vaddr + PGSIZE * map->page_num, false);
+  pagedir_clear_range (cur->pagedir, map->vaddr, 
+                       map->vaddr + PGSIZE * map->page_num);
+  for (int i = 0; i < map->page_num; i++)
+    page_clear (map->vaddr + PGSIZE * i);
+
+  lock_acquire (&filesys_lock);
+  file_close (map->file);
+  lock_release (&filesys_lock);
+  free (map);
+}
+
+/* System call for msync, returns 0 if successful, -1 otherwise. */
+int
+handle_msync (void *addr, unsigned length, int flags)
+{
+  if ((flags & ~(MS_ASYNC | MS_SYNC | MS_INVALIDATE)) != 0
+      || ((flags & MS_ASYNC) && (flags & MS_SYNC)))
+    return -1;
+  return page_msync (addr, length, (flags & MS_ASYNC) != 0) ? 0 : -1;
+}
+
+/* System call for fork, returns the child's pid to the parent.  The 
+   child returns 0 from the same system call. */
+pid_t
+handle_fork (const struct intr_frame *f)
+{
+  return process_fork (f);
+}
+
+/* System call for madvise, returns 0 if successful, -1 otherwise. */
+int
+handle_madvise (void *addr, unsigned length, int advice)
+{
+  if (advice < PAGE_ADV_NORMAL || advice > PAGE_ADV_DONTNEED)
+    return -1;
+  return page_advise (addr, length, advice) ? 0 : -1;
+}
+
+/* System call for mlock, returns 0 if successful, -1 otherwise. */
+int
+handle_mlock (void *addr, unsigned length)
+{
+  return page_mlock (addr, length) ? 0 : -1;
+}
+
+/* System call for munlock, returns 0 if successful, -1 otherwise. */
+int
+handle_munlock (void *addr, unsigned length)
+{
+  return page_munlock (addr, length) ? 0 : -1;
+}
+
+/* System call for memstat, fills UMS with the current process's memory 
+   use.  Kills the process if UMS is not writable. */
+bool
+handle_memstat (struct memstat *ums)
+{
+  struct thread *cur = thread_current ();
+  struct memstat ms;
+  struct page *p;
+
+  if (!valid_check (ums, sizeof *ums))
+    handle_exit (-1);
+  p = find_page (ums, false);
+  if (p->read_only || find_page ((uint8_t *) (ums + 1) - 1, false)->read_only)
+    handle_exit (-1);
+
+  ms.rss = cur->rss;
+  ms.wss = cur->wss;
+  ms.rss_max = cur->rss_max;
+  ms.pinned = cur->pinned_cnt;
+  ms.swapped = cur->swap_cnt;
+  memcpy (ums, &ms, sizeof ms);
+  return true;
+}
+
+/* System call for sbrk, moves the program break INCREMENT bytes and 
+   returns the old break, or (void *) -1 if it cannot be moved. */
+void *
+handle_sbrk (intptr_t increment)
+{
+  void *old_brk = region_sbrk (increment);
+  return old_brk != NULL ? old_brk : (void *) -1;
+}
+
+/* Copy PARENT's open files and memory-mapped files into the current 
+   thread, a child forked from it.  The copies are kept in the same 
+   order as in PARENT, which files_fork_file () relies on. */
+bool
+files_fork (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  bool success = true;
+
+  lock_acquire (&filesys_lock);
+  for (e = list_begin (&parent->opened_files); 
+       success && e != list_end (&parent->opened_files);
+       e = list_next (e))
     {
-      if (pagedir_is_dirty (thread_current ()->pagedir, 
-                            ((const void *) ((map->vaddr) + (PGSIZE * i)))))
+      struct opened_file *f = list_entry (e, struct opened_file, file_elem);
+      struct opened_file *copy = malloc (sizeof *copy);
+      if (copy == NULL)
+        success = false;
+      else if ((copy->file = file_duplicate (f->file)) == NULL)
         {
-          /* For each page, if the page is dirty, write it back to the 
-             file. */
-          lock_acquire (&filesys_lock);
-          file_write_at (map->file, 
-                         (const void *) (map->vaddr + (PGSIZE * i)), 
-                         (PGSIZE * (map->page_num)), (PGSIZE * i));
-          lock_release (&filesys_lock);
+          free (copy);
+          success = false;
+        }
+      else
+        {
+          copy->fd = f->fd;
+          list_push_back (&cur->opened_files, &copy->file_elem);
+        }
+    }
+  for (e = list_begin (&parent->file_maps); 
+       success && e != list_end (&parent->file_maps);
+       e = list_next (e))
+    {
+      struct file_map *map = list_entry (e, struct file_map, elem);
+      struct file_map *copy = malloc (sizeof *copy);
+      if (copy == NULL)
+        success = false;
+      else if ((copy->file = file_reopen (map->file)) == NULL)
+        {
+          free (copy);
+          success = false;
+        }
+      else
+        {
+          copy->fd = map->fd;
+          copy->vaddr = map->vaddr;
+          copy->page_num = map->page_num;
+          list_push_back (&cur->file_maps, &copy->elem);
         }
-      /* For each page, if the page is in the supplemental page table, 
-         remove it. */
-      page_clear ((void *) ((map->vaddr) + (PGSIZE * i)));
     }
+  lock_release (&filesys_lock);
+
+  cur->fd = parent->fd;
+  cur->file_exec = parent->file_exec;
+  return success;
+}
+
+/* Returns the current thread's copy, made by files_fork (), of FILE 
+   opened or memory-mapped by PARENT, or null if PARENT has no such 
+   file. */
+struct file *
+files_fork_file (struct thread *parent, struct file *file)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *c;
+
+  for (e = list_begin (&parent->opened_files), 
+       c = list_begin (&cur->opened_files);
+       e != list_end (&parent->opened_files) 
+       && c != list_end (&cur->opened_files);
+       e = list_next (e), c = list_next (c))
+    if (list_entry (e, struct opened_file, file_elem)->file == file)
+      return list_entry (c, struct opened_file, file_elem)->file;
+
+  for (e = list_begin (&parent->file_maps), c = list_begin (&cur->file_maps);
+       e != list_end (&parent->file_maps) && c != list_end (&cur->file_maps);
+       e = list_next (e), c = list_next (c))
+    if (list_entry (e, struct file_map, elem)->file == file)
+      return list_entry (c, struct file_map, elem)->file;
+  return NULL;
 }
 
 /* P3 update - unmap when exit */
@@ -472,17 +626,25 @@ void
 files_exit (void)
 {
   struct thread *cur = thread_current ();
-  struct list_elem *e;
-  for (e = list_begin (&cur->file_maps); e != list_end (&cur->file_maps);
-       e = list_next (e))
-    handle_munmap (list_entry (e, struct file_map, elem)->fd);
+
+  /* handle_munmap () frees the map, so always take the first one. */
+  while (!list_empty (&cur->file_maps))
+    handle_munmap (list_entry (list_front (&cur->file_maps), 
+                               struct file_map, elem)->fd);
 }
 
 static void
 syscall_handler (struct intr_frame *f) 
 {
+  struct thread *cur = thread_current ();
   unsigned syscall_number;
 
+  /* Keep the OOM killer off this process's frames while in here, and 
+     let a process it killed die on the way in or out. */
+  cur->in_syscall = true;
+  if (cur->oom_killed)
+    handle_exit (-1);
+
   /* extract the syscall number */
   if (!copy_in (&syscall_number, (const void *) f->esp, 
       sizeof syscall_number))
@@ -632,7 +794,66 @@ syscall_handler (struct intr_frame *f)
           handle_munmap (args[0]);
           break;
         }
+      case SYS_FORK:
+        {
+          f->eax = (uint32_t) handle_fork (f);
+          break;
+        }
+      case SYS_MADVISE:
+        {
+          int args[3];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 3))
+            handle_exit (-1);
+          f->eax = handle_madvise ((void *) args[0], (unsigned) args[1],
+                                   args[2]);
+          break;
+        }
+      case SYS_MSYNC:
+        {
+          int args[3];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 3))
+            handle_exit (-1);
+          f->eax = handle_msync ((void *) args[0], (unsigned) args[1],
+                                 args[2]);
+          break;
+        }
+      case SYS_MLOCK:
+        {
+          int args[2];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 2))
+            handle_exit (-1);
+          f->eax = handle_mlock ((void *) args[0], (unsigned) args[1]);
+          break;
+        }
+      case SYS_MUNLOCK:
+        {
+          int args[2];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 2))
+            handle_exit (-1);
+          f->eax = handle_munlock ((void *) args[0], (unsigned) args[1]);
+          break;
+        }
+      case SYS_MEMSTAT:
+        {
+          int args[1];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args))
+            handle_exit (-1);
+          f->eax = handle_memstat ((struct memstat *) args[0]);
+          break;
+        }
+      case SYS_SBRK:
+        {
+          int args[1];
+          if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args))
+            handle_exit (-1);
+          f->eax = (uint32_t) handle_sbrk (args[0]);
+          break;
+        }
       default:
         handle_exit (-1);
     }
+
+  if (cur->oom_killed)
+    handle_exit (-1);
+  cur->in_syscall = false;
 }
@@ -2,9 +2,29 @@
 #define USERPROG_SYSCALL_H
 #include <list.h>
 
+struct file;
+struct thread;
+struct intr_frame;
+
 /* Process identifier. */
 typedef int pid_t;
 typedef int mapid_t;
+
+/* Flags for msync, the same values as in lib/user/syscall.h. */
+#define MS_ASYNC 1              /* Queue the write-back. */
+#define MS_INVALIDATE 2         /* Accepted, has no effect. */
+#define MS_SYNC 4               /* Write back before returning. */
+
+/* Memory use reported by memstat, laid out as in lib/user/syscall.h. */
+struct memstat
+  {
+    size_t rss;                 /* Resident pages. */
+    size_t wss;                 /* Pages used in the last interval. */
+    size_t rss_max;             /* Resident page cap, 0 if none. */
+    size_t pinned;              /* Pages locked by mlock(). */
+    size_t swapped;             /* Swap slots held. */
+  };
+
 struct lock filesys_lock;
 struct opened_file {
     int fd;
@@ -39,4 +59,13 @@ void handle_close (int);
 mapid_t handle_mmap (int, void *);
 void handle_munmap (mapid_t);
 void files_exit(void);
+pid_t handle_fork (const struct intr_frame *);
+int handle_madvise (void *, unsigned, int);
+int handle_msync (void *, unsigned, int);
+int handle_mlock (void *, unsigned);
+int handle_munlock (void *, unsigned);
+bool handle_memstat (struct memstat *);
+void *handle_sbrk (intptr_t);
+bool files_fork (struct thread *);
+struct file *files_fork_file (struct thread *, struct file *);
 #endif /* userprog/syscall.h */
@@ -1,18 +1,108 @@
 #include "vm/frame.h"
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include "vm/oom.h"
 #include "vm/page.h"
+#include "threads/interrupt.h"
+#include "threads/pte.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "devices/timer.h"
 #include "vm/swap.h"
 #include "threads/thread.h"
+#include "userprog/pagedir.h"
 
 static struct frame *frames;
 static struct lock frame_enter_lock;
 static size_t frame_count;
 static size_t evict_loop;
 
+/* Frames with no page, protected by free_frames_lock.  Kept apart
+   from frame_enter_lock so that handing out a free frame never
+   waits behind the eviction clock. */
+static struct list free_frames;
+static struct lock free_frames_lock;
+
+/* Free frames in each run of LARGE_PAGE_CNT frames aligned for a large 
+   page, the first run starting at frame large_first, protected by 
+   free_frames_lock.  Null if the user pool is not physically 
+   contiguous. */
+static size_t *large_free_cnts;
+static size_t large_first;
+static size_t large_run_cnt;
+
+/* Page replacement policy. */
+enum evict_policy frame_evict_policy = EVICT_CLOCK;
+
+/* Frames whose dirty page WSClock passed over, waiting for the
+   page-cleaner thread to write them back. */
+static struct list writeback_queue;
+static struct lock writeback_lock;
+
+/* Page cleaner.  Woken when the number of free frames drops below
+   low_watermark, and again after every high_watermark - low_watermark 
+   frames the clock reclaims while they stay below it, it writes back 
+   dirty pages ahead of the clock until free plus clean frames reach 
+   high_watermark. */
+static struct semaphore cleaner_sema;
+static bool cleaner_started;
+static bool cleaner_wanted;
+static size_t free_frame_cnt;
+static size_t low_watermark;
+static size_t high_watermark;
+static size_t clean_hand;
+
+/* Frames the clock reclaimed for faulting pages since the cleaner last 
+   woke.  With free frames short they stand in for frames taken off the 
+   free list, which no longer cross the low watermark. */
+static size_t evicted_since_wake;
+
+/* Frames holding read-only file pages, keyed by inode and offset, so 
+   that processes running the same executable share its text.  Lock 
+   order is a frame's frame_inuse, then cache_lock. */
+static struct hash page_cache;
+static struct lock cache_lock;
+static long long cache_hit_cnt;
+
+/* Same-page merging.  Every merge_interval ms the page-merger thread 
+   checksums the frames holding anonymous pages, and merges frames with 
+   identical contents into one frame shared copy-on-write. */
+static int merge_interval;
+static long long merge_scan_cnt;
+static long long merged_cnt;
+
+/* Working-set estimation.  Every wss_interval ms the ws-scanner thread
+   samples the accessed bits of the pages in frames and counts, for
+   each process, the pages used since its last pass. */
+static int wss_interval;
+static long long wss_scan_cnt;
+
+/* Pages evicted by processes over their resident-set cap to make room
+   for their own pages. */
+static long long own_evict_cnt;
+
+/* Page cleaner statistics. */
+static long long cleaner_wakeup_cnt;
+static long long cleaned_swap_cnt;
+static long long cleaned_file_cnt;
+
+static thread_func frame_cleaner NO_RETURN;
+static void frame_cleaner_wake (void);
+static void frame_cleaner_evicted (void);
+static void frame_assign (struct frame *, struct page *);
+static void frame_large_count (struct frame *, int);
+static bool frame_over_rss_max (struct thread *);
+static struct frame *frame_evict (struct page *, struct thread *);
+static void frame_uncache (struct frame *);
+static thread_func frame_merger NO_RETURN;
+static thread_func frame_wss_scanner NO_RETURN;
+static hash_hash_func frame_merge_hash;
+static hash_less_func frame_merge_less;
+static hash_hash_func frame_cache_hash;
+static hash_less_func frame_cache_less;
+
 /* Initialize the frame table. */
 void
 frame_table_init (void) 
@@ -25,6 +115,8 @@ frame_table_init (void)
     thread_exit ();
   
   frame_count = 0;
+  list_init (&free_frames);
+  lock_init (&free_frames_lock);
   /* Use a list to store all frames, keep allocating space for each frame
       until there is no space in physical address */
   void *kernel_virtual_address;
@@ -34,82 +126,852 @@ frame_table_init (void)
       lock_init (&f->frame_inuse);
       f->kernel_virtual_address = kernel_virtual_address;
       f->page = NULL;
+      f->page_cnt = 0;
+      f->pin_cnt = 0;
+      f->writeback = false;
+      f->inode = NULL;
+      f->merge_sum = 0;
+      list_push_back (&free_frames, &f->free_elem);
       frame_count++;
     }
 
   /* Synchronize access to the frame table. */
   lock_init (&frame_enter_lock);
 
+  hash_init (&page_cache, frame_cache_hash, frame_cache_less, NULL);
+  lock_init (&cache_lock);
+
+  list_init (&writeback_queue);
+  lock_init (&writeback_lock);
+  sema_init (&cleaner_sema, 0);
+  free_frame_cnt = frame_count;
+
+  /* The frames' physical addresses follow their order in the frame 
+     table, as palloc handed them out, unless the user pool is broken 
+     up.  Then large pages are not possible. */
+  if (frame_count > 0
+      && (uint8_t *) frames[frame_count - 1].kernel_virtual_address
+         == (uint8_t *) frames[0].kernel_virtual_address
+            + (frame_count - 1) * PGSIZE)
+    {
+      uintptr_t base = vtop (frames[0].kernel_virtual_address);
+      large_first = (PTSPAN - base % PTSPAN) % PTSPAN / PGSIZE;
+      if (frame_count > large_first)
+        large_run_cnt = (frame_count - large_first) / LARGE_PAGE_CNT;
+      if (large_run_cnt > 0)
+        large_free_cnts = calloc (large_run_cnt, sizeof *large_free_cnts);
+      if (large_free_cnts != NULL)
+        for (size_t i = 0; i < frame_count; i++)
+          frame_large_count (&frames[i], 1);
+    }
+
   return;
 }
 
-/* Try to allocate a frame for page.
-   return frame is successful, otherwise null. */
-struct frame *
-frame_allocation (struct page *page) 
+/* Start the page-cleaner thread.  LOW and HIGH are the free frame
+   watermarks, or SIZE_MAX to pick them from the size of the frame 
+   table.  A low watermark of 0 leaves only WSClock write-back to the
+   cleaner. */
+void
+frame_cleaner_init (size_t low, size_t high)
 {
-  /* Acquire the frame_enter_lock to ensure exclusive access to the frame 
-     table. */
-  lock_acquire (&frame_enter_lock);
+  low_watermark = low != SIZE_MAX ? low : frame_count / 16;
+  high_watermark = high != SIZE_MAX ? high : frame_count / 8;
+  if (high_watermark < low_watermark)
+    high_watermark = low_watermark;
+
+  cleaner_started = thread_create ("page-cleaner", PRI_DEFAULT,
+                                   frame_cleaner, NULL) != TID_ERROR;
+}
+
+/* Wake the page cleaner if it is not already awake. */
+static void
+frame_cleaner_wake (void)
+{
+  if (cleaner_started && !cleaner_wanted)
+    {
+      cleaner_wanted = true;
+      sema_up (&cleaner_sema);
+    }
+}
+
+/* Count a frame reclaimed by eviction.  Free frames stay below the 
+   low watermark under sustained pressure, so the cleaner is woken once 
+   the clock has reclaimed as many frames as lie between the watermarks, 
+   about what one pass of the cleaner lays in, instead of on every 
+   allocation. */
+static void
+frame_cleaner_evicted (void)
+{
+  if (low_watermark > 0 
+      && ++evicted_since_wake > high_watermark - low_watermark)
+    frame_cleaner_wake ();
+}
+
+/* Queue F so that the page-cleaner thread writes its page back.  The
+   caller must hold F's frame_inuse lock. */
+void
+frame_schedule_writeback (struct frame *f)
+{
+  lock_acquire (&writeback_lock);
+  if (!f->writeback)
+    {
+      f->writeback = true;
+      list_push_back (&writeback_queue, &f->writeback_elem);
+    }
+  lock_release (&writeback_lock);
+  frame_cleaner_wake ();
+}
+
+/* Write back the page in frame F, which the caller has locked, and
+   count it. */
+static void
+frame_clean (struct frame *f)
+{
+  struct page *p = f->page;
+  bool to_file = p->file != NULL && !p->private;
+
+  if (page_writeback (p))
+    {
+      if (to_file)
+        cleaned_file_cnt++;
+      else
+        cleaned_swap_cnt++;
+    }
+}
+
+/* Write the swap-bound pages in the CNT locked frames in BATCH to swap
+   in one go, count them and unlock the frames. */
+static void
+frame_clean_batch (struct frame **batch, size_t cnt)
+{
+  struct page *pages[SWAP_BATCH_MAX];
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  for (i = 0; i < cnt; i++)
+    pages[i] = batch[i]->page;
+  cleaned_swap_cnt += page_writeback_batch (pages, cnt);
+  for (i = 0; i < cnt; i++)
+    lock_release (&batch[i]->frame_inuse);
+}
+
+/* Walk the frame table from where the last walk stopped, writing back
+   pages that have not been used recently, until free and clean frames
+   together reach high_watermark or every frame has been looked at. */
+static void
+frame_cleaner_scan (void)
+{
+  struct frame *batch[SWAP_BATCH_MAX];
+  size_t batch_cnt = 0;
+  size_t clean_cnt = 0;
+
+  for (size_t i = 0; i < frame_count
+                     && free_frame_cnt + clean_cnt < high_watermark; i++)
+    {
+      struct frame *f = &frames[clean_hand];
+      if (++clean_hand >= frame_count)
+        clean_hand = 0;
+
+      if (f->pin_cnt > 0 || !lock_try_acquire (&f->frame_inuse))
+        continue;
+      /* Recently used pages are likely to be dirtied again, and their
+         accessed bit belongs to the eviction clock, so just peek. */
+      if (f->page != NULL && f->page_cnt == 1
+          && !pagedir_is_accessed (f->page->thread->pagedir, 
+                                   f->page->vaddr))
+        {
+          if (page_is_dirty (f->page) && page_to_swap (f->page))
+            {
+              /* Collect swap-bound pages, still locked, and write them 
+                 out together. */
+              batch[batch_cnt++] = f;
+              clean_cnt++;
+              if (batch_cnt == SWAP_BATCH_MAX)
+                {
+                  frame_clean_batch (batch, batch_cnt);
+                  batch_cnt = 0;
+                }
+              continue;
+            }
+          if (page_is_dirty (f->page))
+            frame_clean (f);
+          if (!page_is_dirty (f->page))
+            clean_cnt++;
+        }
+      lock_release (&f->frame_inuse);
+    }
+  frame_clean_batch (batch, batch_cnt);
+}
+
+/* Page cleaner thread.  Writes back the pages queued by 
+   frame_schedule_writeback (), then, if free frames are short, 
+   launders more ahead of the clock, so that evictions find clean 
+   pages that can be dropped without any I/O on the faulting thread. */
+static void
+frame_cleaner (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&cleaner_sema);
+      cleaner_wanted = false;
+      evicted_since_wake = 0;
+      cleaner_wakeup_cnt++;
+
+      for (;;)
+        {
+          struct frame *f = NULL;
+          lock_acquire (&writeback_lock);
+          if (!list_empty (&writeback_queue))
+            {
+              f = list_entry (list_pop_front (&writeback_queue),
+                              struct frame, writeback_elem);
+              f->writeback = false;
+            }
+          lock_release (&writeback_lock);
+          if (f == NULL)
+            break;
+
+          /* The frame may have been evicted, freed or shared since it 
+             was queued, so only write back whatever page lives there 
+             now. */
+          lock_acquire (&f->frame_inuse);
+          if (f->page != NULL && f->page_cnt == 1 && page_is_dirty (f->page))
+            frame_clean (f);
+          lock_release (&f->frame_inuse);
+        }
+
+      if (free_frame_cnt < low_watermark)
+        frame_cleaner_scan ();
+    }
+}
+
+/* Prints page cleaner statistics. */
+void
+frame_print_stats (void)
+{
+  size_t pinned_cnt = 0;
 
-  /* Find a free frame. */
+  for (size_t i = 0; i < frame_count; i++)
+    if (frames[i].pin_cnt > 0)
+      pinned_cnt++;
+  printf ("Page cleaner: watermarks %zu/%zu, %lld wakeups, "
+          "%lld pages cleaned to swap, %lld to file\n",
+          low_watermark, high_watermark, cleaner_wakeup_cnt,
+          cleaned_swap_cnt, cleaned_file_cnt);
+  printf ("Page cache: %zu read-only file pages, %lld shared loads\n",
+          hash_size (&page_cache), cache_hit_cnt);
+  printf ("Pinned frames: %zu of %zu\n", pinned_cnt, frame_count);
+  if (merge_interval > 0)
+    printf ("Page merger: %lld scans, %lld frames saved\n",
+            merge_scan_cnt, merged_cnt);
+  printf ("Resident sets: %lld working-set scans, %lld pages evicted "
+          "over cap\n", wss_scan_cnt, own_evict_cnt);
+}
+
+/* Start the page-merger thread, scanning every INTERVAL ms. */
+void
+frame_merger_init (int interval)
+{
+  merge_interval = interval;
+  thread_create ("page-merger", PRI_MIN, frame_merger, NULL);
+}
+
+/* Checksum table hash function. */
+static unsigned
+frame_merge_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct frame, merge_elem)->merge_sum;
+}
+
+/* Checksum table comparison function. */
+static bool
+frame_merge_less (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED)
+{
+  return hash_entry (a, struct frame, merge_elem)->merge_sum
+         < hash_entry (b, struct frame, merge_elem)->merge_sum;
+}
+
+/* Returns true if every page in locked frame F may be merged with 
+   another frame. */
+static bool
+frame_mergeable (struct frame *f)
+{
+  struct page *p;
+
+  if (f->page == NULL)
+    return false;
+  for (p = f->page; p != NULL; p = p->frame_next)
+    if (!page_mergeable (p))
+      return false;
+  return true;
+}
+
+/* Merge frame B into frame A if their contents are the same.  Once 
+   they compare equal, their pages are write-protected and compared 
+   again, so that the contents cannot change between the comparison and 
+   the merge, then B's pages join A's and B goes to the free list.  
+   Pages that turn out to differ after all get their write access back. 
+   Returns true if B was merged. */
+static bool
+frame_merge (struct frame *a, struct frame *b)
+{
+  bool merged = false;
+  struct page *p;
+
+  if (a == b || !lock_try_acquire (&a->frame_inuse))
+    return false;
+  if (!lock_try_acquire (&b->frame_inuse))
+    {
+      lock_release (&a->frame_inuse);
+      return false;
+    }
+
+  if (frame_mergeable (a) && frame_mergeable (b)
+      && !memcmp (a->kernel_virtual_address, b->kernel_virtual_address, 
+                  PGSIZE))
+    {
+      /* Only a frame's single page can have been writable. */
+      bool a_writable = a->page_cnt == 1 && !a->page->cow;
+      bool b_writable = b->page_cnt == 1 && !b->page->cow;
+
+      for (p = a->page; p != NULL; p = p->frame_next)
+        page_protect (p);
+      for (p = b->page; p != NULL; p = p->frame_next)
+        page_protect (p);
+      if (!memcmp (a->kernel_virtual_address, b->kernel_virtual_address, 
+                   PGSIZE))
+        {
+          /* The last page to leave frees B. */
+          while (b->page != NULL)
+            page_remap (b->page, a);
+          merged = true;
+        }
+      else
+        {
+          /* Written to before the protection took hold. */
+          if (a_writable)
+            page_unprotect (a->page);
+          if (b_writable)
+            page_unprotect (b->page);
+        }
+    }
+
+  lock_release (&b->frame_inuse);
+  lock_release (&a->frame_inuse);
+  return merged;
+}
+
+/* Checksum the mergeable frames and merge those with the same contents. 
+   A frame whose checksum changed since the last scan is being written 
+   to and is left alone, merging it would only cause copy-on-write 
+   faults. */
+static void
+frame_merge_scan (void)
+{
+  struct hash sums;
+
+  if (!hash_init (&sums, frame_merge_hash, frame_merge_less, NULL))
+    return;
   for (size_t i = 0; i < frame_count; i++)
     {
       struct frame *f = &frames[i];
+      unsigned sum;
 
-      /* Try to acquire the frame_inuse lock for the current frame. */
-      bool acquired = lock_try_acquire (&f->frame_inuse);
-      if (!acquired)
-        /* Frame is currently in use, will try next frame. */
+      if (!lock_try_acquire (&f->frame_inuse))
         continue;
-
-      /* Check if the current frame is free. */
-      if (f->page != NULL)
+      if (!frame_mergeable (f))
         {
-          /* Release the frame_inuse lock for the current frame. */
           lock_release (&f->frame_inuse);
           continue;
         }
+      sum = hash_bytes (f->kernel_virtual_address, PGSIZE);
+      lock_release (&f->frame_inuse);
+      if (sum != f->merge_sum)
+        {
+          f->merge_sum = sum;
+          continue;
+        }
+
+      struct hash_elem *e = hash_find (&sums, &f->merge_elem);
+      if (e == NULL)
+        hash_insert (&sums, &f->merge_elem);
+      else if (frame_merge (hash_entry (e, struct frame, merge_elem), f))
+        merged_cnt++;
+    }
+  hash_destroy (&sums, NULL);
+  merge_scan_cnt++;
+}
 
-      /* Assign the given page to the frame. */
-      f->page = page;
+/* Page-merger thread.  Runs at the lowest priority so that scanning 
+   only takes otherwise idle time. */
+static void
+frame_merger (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (merge_interval);
+      frame_merge_scan ();
+    }
+}
 
-      /* Release the frame_enter_lock to allow other threads to allocate 
-        frames. */
-      lock_release (&frame_enter_lock);
+/* Start the ws-scanner thread, sampling every INTERVAL ms. */
+void
+frame_wss_init (int interval)
+{
+  wss_interval = interval;
+  thread_create ("ws-scanner", PRI_DEFAULT, frame_wss_scanner, NULL);
+}
 
-      return f;
+/* Publish thread T's working-set count for the interval just ended. */
+static void
+frame_wss_update (struct thread *t, void *aux UNUSED)
+{
+  t->wss = t->wss_next;
+  t->wss_next = 0;
+}
+
+/* Count the pages in frames accessed since the last scan into their
+   thread's wss_next, then publish the counts.  Frames locked by
+   someone else are skipped, so the counts are a sample. */
+static void
+frame_wss_scan (void)
+{
+  enum intr_level old_level;
+
+  for (size_t i = 0; i < frame_count; i++)
+    {
+      struct frame *f = &frames[i];
+      struct page *p;
+
+      if (!lock_try_acquire (&f->frame_inuse))
+        continue;
+      for (p = f->page; p != NULL; p = p->frame_next)
+        if (page_sample_accessed (p))
+          p->thread->wss_next++;
+      lock_release (&f->frame_inuse);
+    }
+
+  old_level = intr_disable ();
+  thread_foreach (frame_wss_update, NULL);
+  intr_set_level (old_level);
+  wss_scan_cnt++;
+}
+
+/* Working-set scanner thread. */
+static void
+frame_wss_scanner (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (wss_interval);
+      frame_wss_scan ();
     }
+}
+
+/* Page cache hash function, on inode and offset. */
+static unsigned
+frame_cache_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, cache_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->inode_ofs);
+}
+
+/* Page cache comparison function. */
+static bool
+frame_cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+  const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->inode_ofs != b->inode_ofs)
+    return a->inode_ofs < b->inode_ofs;
+  return a->inode_bytes < b->inode_bytes;
+}
+
+/* Record that locked frame F holds the read-only page of INODE at OFS, 
+   BYTES long, unless some frame already does. */
+void
+frame_cache_insert (struct frame *f, struct inode *inode, off_t ofs,
+                    off_t bytes)
+{
+  ASSERT (lock_held_by_current_thread (&f->frame_inuse));
+  ASSERT (f->inode == NULL);
+
+  f->inode = inode;
+  f->inode_ofs = ofs;
+  f->inode_bytes = bytes;
+  lock_acquire (&cache_lock);
+  if (hash_insert (&page_cache, &f->cache_elem) != NULL)
+    f->inode = NULL;
+  lock_release (&cache_lock);
+}
+
+/* Look for the read-only page of INODE at OFS, BYTES long, in the page 
+   cache.  If it is there, add PAGE to the frame's sharers and return 
+   the frame locked, otherwise return null. */
+struct frame *
+frame_cache_share (struct page *page, struct inode *inode, off_t ofs,
+                   off_t bytes)
+{
+  struct frame key;
+  struct hash_elem *e;
+  struct frame *f = NULL;
+
+  key.inode = inode;
+  key.inode_ofs = ofs;
+  key.inode_bytes = bytes;
+  lock_acquire (&cache_lock);
+  e = hash_find (&page_cache, &key.cache_elem);
+  if (e != NULL)
+    f = hash_entry (e, struct frame, cache_elem);
+  lock_release (&cache_lock);
+  if (f == NULL)
+    return NULL;
+
+  /* The frame lock comes first, so check again that the frame still 
+     holds the page once it is locked. */
+  lock_acquire (&f->frame_inuse);
+  if (f->inode != inode || f->inode_ofs != ofs || f->inode_bytes != bytes
+      || f->page == NULL)
+    {
+      lock_release (&f->frame_inuse);
+      return NULL;
+    }
+  frame_share (f, page);
+  cache_hit_cnt++;
+  return f;
+}
+
+/* Drop locked frame F from the page cache, as its page is leaving. */
+static void
+frame_uncache (struct frame *f)
+{
+  if (f->inode == NULL)
+    return;
+  lock_acquire (&cache_lock);
+  hash_delete (&page_cache, &f->cache_elem);
+  lock_release (&cache_lock);
+  f->inode = NULL;
+}
+
+/* Pop a frame off the free list and assign it to PAGE.
+   Return the frame locked, or null if no frame is free. */
+static struct frame *
+frame_pop_free (struct page *page)
+{
+  struct frame *f = NULL;
+  bool wake = false;
+
+  lock_acquire (&free_frames_lock);
+  if (!list_empty (&free_frames))
+    {
+      f = list_entry (list_pop_front (&free_frames), struct frame, free_elem);
+      free_frame_cnt--;
+      frame_large_count (f, -1);
+      /* Wake the cleaner as free frames drop below the low watermark, 
+         not on every allocation while they stay there. */
+      wake = free_frame_cnt + 1 == low_watermark;
+    }
+  lock_release (&free_frames_lock);
+
+  if (wake)
+    frame_cleaner_wake ();
+  if (f == NULL)
+    return NULL;
+
+  /* The frame is off the free list so nobody else can claim it, but
+     frame_reset () may still be holding its lock. */
+  lock_acquire (&f->frame_inuse);
+  ASSERT (f->page == NULL);
+  frame_assign (f, page);
+  return f;
+}
+
+/* Make PAGE the only page in frame F, which the caller has locked. */
+static void
+frame_assign (struct frame *f, struct page *page)
+{
+  frame_uncache (f);
+  f->page = page;
+  f->page_cnt = 1;
+  page->frame_next = NULL;
+  page_rss_add (page, 1);
+}
+
+/* Evict VICTIM, whose page is dirty and bound for swap, together with
+   up to SWAP_BATCH_MAX - 1 more such pages found under the clock hand,
+   in one batched swap write.  VICTIM is then given to PAGE and the
+   other frames go to the free list.  The caller holds VICTIM's lock
+   and frame_enter_lock, which is released here.  Returns VICTIM, or
+   null if it could not be evicted. */
+static struct frame *
+frame_evict_cluster (struct frame *victim, struct page *page)
+{
+  struct frame *cluster[SWAP_BATCH_MAX];
+  struct page *pages[SWAP_BATCH_MAX];
+  size_t cnt = 0;
+  size_t i;
+
+  cluster[cnt++] = victim;
+  for (i = 0; i < SWAP_BATCH_MAX * 2 && cnt < SWAP_BATCH_MAX; i++)
+    {
+      struct frame *f = &frames[evict_loop];
+      if (++evict_loop >= frame_count)
+        evict_loop = 0;
+      if (f == victim || f->pin_cnt > 0 
+          || !lock_try_acquire (&f->frame_inuse))
+        continue;
+      if (f->page != NULL && f->page_cnt == 1 
+          && !page_check_accessed (f->page)
+          && page_is_dirty (f->page) && page_to_swap (f->page))
+        cluster[cnt++] = f;
+      else
+        lock_release (&f->frame_inuse);
+    }
+  lock_release (&frame_enter_lock);
+
+  for (i = 0; i < cnt; i++)
+    pages[i] = cluster[i]->page;
+  page_evict_batch (pages, cnt);
+
+  for (i = 1; i < cnt; i++)
+    {
+      /* Frames whose page made it to swap are free now. */
+      if (pages[i]->frame == NULL)
+        frame_reset (cluster[i]);
+      lock_release (&cluster[i]->frame_inuse);
+    }
+
+  if (pages[0]->frame != NULL)
+    {
+      /* Check if eviction failed. */
+      lock_release (&victim->frame_inuse);
+      return NULL;
+    }
+  /* Eviction successful. Will use this frame */
+  frame_assign (victim, page);
+  return victim;
+}
+
+/* Allocate a free frame for page without evicting anything, for 
+   speculative loads.  Return the frame locked, otherwise null. */
+struct frame *
+frame_allocation_free (struct page *page)
+{
+  if (frame_over_rss_max (page->thread))
+    return NULL;
+  return frame_pop_free (page);
+}
+
+/* Take LARGE_PAGE_CNT free frames that are physically contiguous 
+   and aligned for a large page off the free list and give them to 
+   PAGES, which must all belong to the same thread, in order.  Returns 
+   the first frame, with all of them locked, or null if there is no 
+   such run of free frames or the thread may not have that many more.  
+   Never evicts, and leaves the cleaner its low watermark of free 
+   frames. */
+struct frame *
+frame_allocation_large (struct page **pages)
+{
+  struct thread *t = pages[0]->thread;
+  struct frame *f = NULL;
+  size_t run, i;
+
+  if (large_free_cnts == NULL
+      || (t->rss_max > 0 && t->rss + LARGE_PAGE_CNT > t->rss_max))
+    return NULL;
+
+  lock_acquire (&free_frames_lock);
+  if (free_frame_cnt >= LARGE_PAGE_CNT + low_watermark)
+    /* Take the first run that is entirely free. */
+    for (run = 0; run < large_run_cnt; run++)
+      if (large_free_cnts[run] == LARGE_PAGE_CNT)
+        {
+          f = &frames[large_first + run * LARGE_PAGE_CNT];
+          for (i = 0; i < LARGE_PAGE_CNT; i++)
+            list_remove (&f[i].free_elem);
+          large_free_cnts[run] = 0;
+          free_frame_cnt -= LARGE_PAGE_CNT;
+          break;
+        }
+  lock_release (&free_frames_lock);
+
+  if (f == NULL)
+    return NULL;
+  if (free_frame_cnt < low_watermark)
+    frame_cleaner_wake ();
+  for (i = 0; i < LARGE_PAGE_CNT; i++)
+    {
+      /* As in frame_pop_free (). */
+      lock_acquire (&f[i].frame_inuse);
+      ASSERT (f[i].page == NULL);
+      frame_assign (&f[i], pages[i]);
+    }
+  return f;
+}
+
+/* Count frame F, which just went onto the free list or off it, into 
+   the free frames of its large-page run.  The caller holds 
+   free_frames_lock. */
+static void
+frame_large_count (struct frame *f, int delta)
+{
+  size_t idx = f - frames;
+
+  if (large_free_cnts != NULL && idx >= large_first
+      && (idx - large_first) / LARGE_PAGE_CNT < large_run_cnt)
+    large_free_cnts[(idx - large_first) / LARGE_PAGE_CNT] += delta;
+}
+
+/* Returns the number of free frames. */
+size_t
+frame_free_count (void)
+{
+  return free_frame_cnt;
+}
+
+/* Try to allocate a frame for page.
+   return frame is successful, otherwise null. */
+struct frame *
+frame_allocation (struct page *page) 
+{
+  struct frame *f;
+
+  /* Over its resident-set cap, a process makes room among its own
+     pages, and only takes another frame if none of them can go. */
+  if (frame_over_rss_max (page->thread))
+    {
+      f = frame_evict (page, page->thread);
+      if (f != NULL)
+        {
+          own_evict_cnt++;
+          return f;
+        }
+    }
+
+  /* Use a free frame if there is one. */
+  f = frame_pop_free (page);
+  if (f != NULL)
+    return f;
+
+  /* Evict a page, and if nothing can be evicted have the OOM killer 
+     make room. */
+  for (int tries = 0; ; tries++)
+    {
+      f = frame_evict (page, NULL);
+      if (f != NULL)
+        frame_cleaner_evicted ();
+      if (f != NULL || tries == OOM_RETRIES || !oom_kill ())
+        return f;
+      f = frame_pop_free (page);
+      if (f != NULL)
+        return f;
+    }
+}
+
+/* Returns true if thread T has reached its resident-set cap. */
+static bool
+frame_over_rss_max (struct thread *t)
+{
+  return t->rss_max > 0 && t->rss >= t->rss_max;
+}
+
+/* Evict a page to make room for PAGE and return its frame locked, or
+   null if no frame could be had.  If OWNER is not null, only its own
+   pages are considered. */
+static struct frame *
+frame_evict (struct page *page, struct thread *owner)
+{
+  struct frame *f;
+
+  /* Acquire the frame_enter_lock to ensure exclusive access to the frame 
+     table. */
+  lock_acquire (&frame_enter_lock);
 
   /* No free frame.  Find a frame to evict and try multiple times. */
   for (size_t i = 0; i < frame_count * 3; i++) 
     {
       /* Get a frame. */
-      struct frame *f = &frames[evict_loop];
+      f = &frames[evict_loop];
       evict_loop ++;
       if (evict_loop >= frame_count)
       /* Reset evict_loop to 0 to start from the beginning of the frame table, 
          as new frame may become avliable. */
         evict_loop = 0;
-        
+
+      if (f->pin_cnt > 0)
+        /* Locked by mlock (), not even worth taking its lock. */
+        continue;
       if (!lock_try_acquire (&f->frame_inuse))
         /* Frame is in use. Go to next frame */
         continue;
 
+      if (owner != NULL
+          && (f->page == NULL || f->page_cnt > 1
+              || f->page->thread != owner))
+        {
+          /* Not a frame of OWNER's alone. */
+          lock_release (&f->frame_inuse);
+          continue;
+        }
+
       if (f->page == NULL) 
         {
-          /* Frame is free. Will use this frame */
-          f->page = page;
-          lock_release (&frame_enter_lock);
-          return f;
+          /* Frame was freed during the scan, so it sits on the free list 
+             and belongs to whoever pops it from there. */
+          lock_release (&f->frame_inuse);
+          f = frame_pop_free (page);
+          if (f != NULL)
+            {
+              lock_release (&frame_enter_lock);
+              return f;
+            }
+          continue;
         } 
 
-      if (page_check_accessed (f->page)) 
+      if (frame_check_accessed (f)) 
         {
           /* Frame is recently accessed. Go to next frame */
           lock_release (&f->frame_inuse);
           continue;
         }
+
+      if (f->page_cnt > 1)
+        {
+          /* Frame shared after fork (), every sharer has to let go of 
+             it. */
+          lock_release (&frame_enter_lock);
+          if (!page_evict_shared (f->page))
+            {
+              lock_release (&f->frame_inuse);
+              return NULL;
+            }
+          frame_assign (f, page);
+          return f;
+        }
+
+      if (frame_evict_policy == EVICT_WSCLOCK && i < frame_count * 2
+          && page_is_dirty (f->page))
+        {
+          /* WSClock: evicting a dirty page means waiting for its write on 
+             this thread.  For the first two sweeps hand it to the 
+             page cleaner instead and keep looking for a clean victim; the 
+             last sweep takes whatever it finds. */
+          frame_schedule_writeback (f);
+          lock_release (&f->frame_inuse);
+          continue;
+        }
+
+      if (owner == NULL && page_is_dirty (f->page)
+          && page_to_swap (f->page))
+        /* The victim has to go to swap anyway, so take its neighbours 
+           along in the same swap write. */
+        return frame_evict_cluster (f, page);
           
       lock_release (&frame_enter_lock);
       
@@ -121,7 +983,7 @@ frame_allocation (struct page *page)
           return NULL;
         }
       /* Eviction successful. Will use this frame */
-      f->page = page;
+      frame_assign (f, page);
       return f;
     }
 
@@ -130,23 +992,128 @@ frame_allocation (struct page *page)
   return NULL;
 }
 
+/* Return frame F to the free list.  The caller must hold F's 
+   frame_inuse lock. */
+void
+frame_reset (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->frame_inuse));
+  ASSERT (f->pin_cnt == 0);
+
+  frame_uncache (f);
+  f->page = NULL;
+  f->page_cnt = 0;
+  lock_acquire (&free_frames_lock);
+  list_push_back (&free_frames, &f->free_elem);
+  free_frame_cnt++;
+  frame_large_count (f, 1);
+  lock_release (&free_frames_lock);
+}
+
+/* Let page P share frame F with the pages already in it, as fork () 
+   does.  The caller must hold F's frame_inuse lock. */
+void
+frame_share (struct frame *f, struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&f->frame_inuse));
+  ASSERT (f->page != NULL);
+
+  /* Keep the first page first, the clock and the cleaner look at it. */
+  p->frame = f;
+  p->frame_next = f->page->frame_next;
+  f->page->frame_next = p;
+  f->page_cnt++;
+  page_rss_add (p, 1);
+}
+
+/* Take page P out of frame F, and return F to the free list if no 
+   page is left in it.  The caller must hold F's frame_inuse lock. */
+void
+frame_remove_page (struct frame *f, struct page *p)
+{
+  struct page **pp;
+
+  ASSERT (lock_held_by_current_thread (&f->frame_inuse));
+
+  for (pp = &f->page; *pp != NULL; pp = &(*pp)->frame_next)
+    if (*pp == p)
+      {
+        *pp = p->frame_next;
+        f->page_cnt--;
+        break;
+      }
+  p->frame = NULL;
+  p->frame_next = NULL;
+  page_rss_add (p, -1);
+  if (f->page == NULL)
+    frame_reset (f);
+}
+
+/* Take the pages of thread T, killed for memory, out of every frame 
+   that is not locked, freeing the frames no other process shares. 
+   Returns the number of pages taken out. */
+size_t
+frame_reclaim (struct thread *t)
+{
+  size_t cnt = 0;
+
+  for (size_t i = 0; i < frame_count; i++)
+    {
+      struct frame *f = &frames[i];
+      struct page *p, *next;
+
+      if (!lock_try_acquire (&f->frame_inuse))
+        continue;
+      for (p = f->page; p != NULL; p = next)
+        {
+          next = p->frame_next;
+          /* A thread created since T died may live where T did. */
+          if (p->thread == t && t->oom_killed)
+            {
+              page_drop (p);
+              cnt++;
+            }
+        }
+      lock_release (&f->frame_inuse);
+    }
+  return cnt;
+}
+
+/* Returns true if any page in frame F was accessed since the last 
+   check, clearing the accessed bits.  F must be locked. */
+bool
+frame_check_accessed (struct frame *f)
+{
+  bool accessed = false;
+  struct page *p;
+
+  for (p = f->page; p != NULL; p = p->frame_next)
+    if (page_check_accessed (p))
+      accessed = true;
+  return accessed;
+}
+
 /* Lock page p's frame to disallow changes and eviction */
 void
 frame_acquire_lock (struct page *p) 
 {
-  struct frame *f = p->frame;
-  /* If the page has no frame, return. */
-  if (f == NULL)
-    return;
+  for (;;)
+    {
+      struct frame *f = p->frame;
+      /* If the page has no frame, return. */
+      if (f == NULL)
+        return;
 
-  /* If a frame exists, acquire the lock for that frame. */
-  lock_acquire (&f->frame_inuse);
+      /* If a frame exists, acquire the lock for that frame. */
+      lock_acquire (&f->frame_inuse);
 
-  /* Verify that the page's frame has not changed since it was last accessed.
-     If the frame was removed asynchronously, release the lock and assert that
-     the frame is no longer associated with the page. */
-  if (f != p->frame)
-    lock_release (&f->frame_inuse);
+      /* Verify that the page's frame has not changed since it was last 
+         accessed.  If the frame was removed asynchronously, or the page 
+         moved to another frame, release the lock and try again. */
+      if (f == p->frame)
+        return;
+      lock_release (&f->frame_inuse);
+    }
 }
 
 /* Release page p's frame lock to allow eviction. */
@@ -1,21 +1,84 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+#include <hash.h>
+#include <list.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 
+struct thread;
+
+/* Frames in a large page. */
+#define LARGE_PAGE_CNT (PTSPAN / PGSIZE)
+
 /* A physical frame. */
 struct frame 
   {
     struct lock frame_inuse;            /* Lock if frame is in use. */
     void *kernel_virtual_address;       /* Kernel virtual base address. */
-    struct page *page;                  /* Page maapped to this frame. */
+    struct page *page;                  /* Page maapped to this frame, 
+                                           first of its sharers. */
+    size_t page_cnt;                    /* Number of pages sharing this 
+                                           frame after fork (). */
+    unsigned pin_cnt;                   /* Pages in the frame locked by 
+                                           mlock (), the clock and the 
+                                           cleaner pass it by if 
+                                           nonzero. */
+    struct list_elem free_elem;         /* Element in free frame list. */
+    bool writeback;                     /* True if queued for write-back. */
+    struct list_elem writeback_elem;    /* Element in write-back queue. */
+
+    /* Read-only file page cache, protected by frame_inuse. */
+    struct inode *inode;                /* Inode of cached page, or null. */
+    off_t inode_ofs;                    /* Offset of cached page. */
+    off_t inode_bytes;                  /* Bytes read from the inode. */
+    struct hash_elem cache_elem;        /* Element in page cache. */
+
+    /* Same-page merging, owned by the page-merger thread. */
+    unsigned merge_sum;                 /* Checksum at the last scan. */
+    struct hash_elem merge_elem;        /* Element in checksum table. */
   };
 
+/* Page replacement policies, chosen with "-evict=POLICY". */
+enum evict_policy
+  {
+    EVICT_CLOCK,                        /* One-handed clock. */
+    EVICT_WSCLOCK                       /* WSClock, prefers clean victims. */
+  };
+
+extern enum evict_policy frame_evict_policy;
+
 void frame_table_init (void);           /* Initialaize frame table. */
 struct frame *frame_allocation (struct page *page); 
                                         /* Map page to one frame. */
+struct frame *frame_allocation_free (struct page *page);
+                                        /* Same, but never evicts. */
+struct frame *frame_allocation_large (struct page **pages);
+                                        /* Frames for a large page. */
+size_t frame_free_count (void);         /* Number of free frames. */
 void frame_acquire_lock (struct page *p);        /* Lock frame. */
 void frame_release_lock (struct page *p);      /* Unlock frame. */
 void frame_reset (struct frame *);       /* Free frame. */
+void frame_share (struct frame *, struct page *);
+                                        /* Add a sharer to a frame. */
+void frame_remove_page (struct frame *, struct page *);
+                                        /* Drop a sharer from a frame. */
+size_t frame_reclaim (struct thread *); /* Free a killed thread's frames. */
+bool frame_check_accessed (struct frame *);
+                                        /* Accessed through any sharer. */
+void frame_cache_insert (struct frame *, struct inode *, off_t, off_t);
+                                        /* Cache a read-only file page. */
+struct frame *frame_cache_share (struct page *, struct inode *, off_t, 
+                                 off_t);
+                                        /* Share a cached file page. */
+void frame_cleaner_init (size_t low, size_t high);
+                                        /* Start the page cleaner. */
+void frame_schedule_writeback (struct frame *);
+                                        /* Queue a page for write-back. */
+void frame_merger_init (int interval);  /* Start same-page merging. */
+void frame_wss_init (int interval);     /* Start working-set scans. */
+void frame_print_stats (void);          /* Print page cleaner stats. */
 
 #endif /* vm/frame.h */
@@ -0,0 +1,211 @@
+#include "vm/oom.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/spt.h"
+#include "vm/swap.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Out-of-memory killer.  When no frame can be had by eviction, because
+   every frame is locked or swap is full, the process holding the most
+   memory is killed and its frames are reclaimed right away.  Without
+   it the process that happened to fault would die, which is rarely
+   the one to blame.
+
+   A process is scored by its resident pages plus its swap slots.
+   Only processes running user code are victims.  In a system call, a
+   page fault or still loading, the kernel may be using a process's
+   pages without holding their frames, so nothing could be taken from
+   it.  The victim is marked and dies when it next enters the kernel. 
+   Its frames and the swap slots of its pages that are swapped out are
+   taken from it at once. */
+
+/* Held while the killer frees a victim's swap slots, so that the 
+   victim cannot free its pages meanwhile. */
+static struct lock oom_lock;
+
+/* Statistics. */
+static long long oom_kill_cnt;          /* Processes killed. */
+static long long oom_reclaim_cnt;       /* Pages taken from them. */
+static long long oom_slot_cnt;          /* Swap slots freed. */
+static long long oom_fail_cnt;          /* Allocations failed anyway. */
+
+/* State of the search for a victim, see oom_consider (). */
+struct oom_search
+  {
+    struct thread *cur;         /* The thread allocating. */
+    struct thread *victim;      /* Process with the highest score. */
+    size_t score;               /* Its score. */
+    size_t swapped;             /* Its swap slots. */
+    struct thread *killed;      /* Killed earlier, still holding 
+                                   frames or swap slots. */
+    bool skip_killed;           /* Leave processes killed earlier out. */
+  };
+
+/* thread_foreach () callback looking at thread T for the search in 
+   SEARCH_. */
+static void
+oom_consider (struct thread *t, void *search_)
+{
+  struct oom_search *s = search_;
+
+  if (t->sup_page_table == NULL)
+    /* Kernel thread, or a process that has freed its pages. */
+    return;
+  if (t != s->cur && t->in_syscall)
+    /* Nothing can be taken from it, it may not hold on to anything 
+       for long. */
+    return;
+  if (t->oom_killed)
+    {
+      if (!s->skip_killed && t->rss + t->swap_cnt > 0)
+        s->killed = t;
+      return;
+    }
+  if (s->victim == NULL || t->rss + t->swap_cnt > s->score)
+    {
+      s->victim = t;
+      s->score = t->rss + t->swap_cnt;
+      s->swapped = t->swap_cnt;
+    }
+}
+
+/* spt_for_each () callback freeing the swap slot of page P if it is 
+   swapped out, counting it in *CNT_.  Pages with a frame are left to 
+   frame_reclaim (), or are being written out by another thread. */
+static bool
+oom_drop_swap (struct page *p, void *cnt_)
+{
+  size_t *cnt = cnt_;
+
+  if (p->frame == NULL && p->sector != (block_sector_t) -1)
+    {
+      swap_drop (p);
+      (*cnt)++;
+    }
+  return true;
+}
+
+/* Take the frames and swap slots of T, which was killed while running 
+   user code.  Interrupts must be off on entry, they are on when this 
+   returns.  Returns the number of pages taken, and the number of swap 
+   slots freed in *SLOTS. */
+static size_t
+oom_reclaim (struct thread *t, size_t *slots)
+{
+  size_t cnt;
+
+  /* T dies as soon as it runs, freeing each of its pages under its 
+     frame's lock, so a page frame_reclaim () finds in a locked frame 
+     is still T's.  Its swapped-out pages are not touched by anyone 
+     but T, which waits in oom_exit () for the killer to be done. */
+  intr_enable ();
+  cnt = frame_reclaim (t);
+  oom_reclaim_cnt += cnt;
+  *slots = 0;
+  if (t->sup_page_table != NULL)
+    spt_for_each (t->sup_page_table, oom_drop_swap, slots);
+  oom_slot_cnt += *slots;
+  return cnt;
+}
+
+/* Initialize the OOM killer. */
+void
+oom_init (void)
+{
+  lock_init (&oom_lock);
+}
+
+/* Called by the current process before it frees its pages.  Waits for 
+   the killer to be done with its swap slots, and hides its pages from 
+   the killer. */
+void
+oom_exit (void)
+{
+  lock_acquire (&oom_lock);
+  thread_current ()->sup_page_table = NULL;
+  lock_release (&oom_lock);
+}
+
+/* Called when no frame can be evicted.  Kills the process running 
+   user code with the highest score, unless that is the current one, 
+   and takes its frames and swap slots.  If a process killed earlier is 
+   still around with some of them, takes those first.  Returns true if 
+   the allocation should be retried, false if it should fail. */
+bool
+oom_kill (void)
+{
+  struct thread *cur = thread_current ();
+  struct oom_search s;
+  char name[sizeof cur->name];
+  tid_t tid;
+  size_t rss, cnt, slots;
+
+  lock_acquire (&oom_lock);
+  memset (&s, 0, sizeof s);
+  s.cur = cur;
+  intr_disable ();
+  thread_foreach (oom_consider, &s);
+
+  if (s.killed != NULL)
+    {
+      /* What it kept, because another thread had the frames locked, 
+         may be enough without killing another process. */
+      strlcpy (name, s.killed->name, sizeof name);
+      tid = s.killed->tid;
+      cnt = oom_reclaim (s.killed, &slots);
+      printf ("oom: %s (tid %d) already killed, %zu pages reclaimed, "
+              "%zu swap slots freed\n", name, tid, cnt, slots);
+      if (cnt + slots > 0)
+        {
+          lock_release (&oom_lock);
+          return true;
+        }
+
+      /* Look again, processes may have entered the kernel meanwhile. */
+      memset (&s, 0, sizeof s);
+      s.cur = cur;
+      s.skip_killed = true;
+      intr_disable ();
+      thread_foreach (oom_consider, &s);
+    }
+
+  if (s.victim == NULL || s.victim == cur)
+    {
+      intr_enable ();
+      lock_release (&oom_lock);
+      oom_fail_cnt++;
+      if (s.victim == NULL)
+        printf ("oom: no process to kill, failing the allocation of %s "
+                "(tid %d)\n", cur->name, cur->tid);
+      else
+        printf ("oom: %s (tid %d) uses the most memory, failing its "
+                "allocation\n", cur->name, cur->tid);
+      return false;
+    }
+
+  s.victim->oom_killed = true;
+  oom_kill_cnt++;
+  strlcpy (name, s.victim->name, sizeof name);
+  tid = s.victim->tid;
+  rss = s.victim->rss;
+  cnt = oom_reclaim (s.victim, &slots);
+  lock_release (&oom_lock);
+  printf ("oom: killed %s (tid %d) with %zu resident pages and %zu swap "
+          "slots, %zu pages reclaimed, %zu swap slots freed\n", 
+          name, tid, rss, s.swapped, cnt, slots);
+  return true;
+}
+
+/* Prints out-of-memory statistics. */
+void
+oom_print_stats (void)
+{
+  printf ("OOM killer: %lld processes killed, %lld pages reclaimed, "
+          "%lld swap slots freed, %lld allocations failed\n",
+          oom_kill_cnt, oom_reclaim_cnt, oom_slot_cnt, oom_fail_cnt);
+}
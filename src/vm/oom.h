@@ -0,0 +1,19 @@
+#ifndef VM_OOM_H
+#define VM_OOM_H 1
+
+#include <stdbool.h>
+
+/* Times an allocation that cannot evict anything calls oom_kill ()
+   before it gives up. */
+#define OOM_RETRIES 8
+
+/* Initialize the OOM killer */
+void oom_init (void);
+/* Free memory by killing the process using the most */
+bool oom_kill (void);
+/* Wait for the OOM killer before freeing the current process's pages */
+void oom_exit (void);
+/* Print out-of-memory statistics */
+void oom_print_stats (void);
+
+#endif /* vm/oom.h */
@@ -1,18 +1,96 @@
 #include "vm/page.h"
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "vm/frame.h"
+#include "vm/oom.h"
+#include "vm/region.h"
+#include "vm/spt.h"
 #include "vm/swap.h"
 #include "filesys/file.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "threads/vaddr.h"
 
-/* Maximum size for process stack. */
-#define STACK_MAX (1024 * 1024)
+/* Swap read-ahead window in pages, including the faulting page.  It 
+   grows when read-ahead pages get used and shrinks when they are 
+   evicted untouched. */
+#define SWAP_RA_MIN 2
+#define SWAP_RA_MAX SWAP_BATCH_MAX
+static size_t swap_ra_window = 4;
 
-/* Allocate a page for user and add the page to user pages hash tabale.
+/* Most pages msync () writes back with one file write. */
+#define SYNC_RUN_MAX 32
+
+/* Pages of the same file read ahead when faults on it are sequential, 
+   and when madvise() said they would be. */
+#define FILE_RA_PAGES 8
+#define FILE_RA_SEQ_PAGES 16
+
+/* Most pages an eager load reads with one file read. */
+#define EAGER_RUN_MAX 64
+
+/* Swap read-ahead statistics. */
+static long long swap_ra_cnt;
+static long long swap_ra_hit_cnt;
+static long long swap_ra_miss_cnt;
+
+/* File read-ahead statistics. */
+static long long file_ra_cnt;
+static long long file_ra_hit_cnt;
+
+/* Zero-filled kernel page, mapped read-only into untouched anonymous 
+   pages that are only read so far. */
+static void *zero_kpage;
+
+/* Zero page statistics. */
+static long long zero_map_cnt;
+static long long zero_copy_cnt;
+
+/* madvise() statistics. */
+static long long willneed_cnt;
+static long long dontneed_cnt;
+
+/* msync () statistics. */
+static long long sync_page_cnt;
+static long long sync_write_cnt;
+
+size_t page_mlock_max = 64;
+size_t page_rss_max;
+size_t page_fault_around = 16;
+bool page_large;
+size_t page_eager_max;
+
+/* Fault-around statistics. */
+static long long fault_cnt;
+static long long fault_around_cnt;
+
+/* Blocks mapped with a large page. */
+static long long large_map_cnt;
+
+/* Eager load statistics. */
+static long long eager_page_cnt;
+static long long eager_read_cnt;
+
+/* mlock () statistics. */
+static long long mlock_cnt;
+static long long mlock_refused_cnt;
+
+/* Allocate the shared zero page.  Without it every page gets a frame 
+   of its own on its first access, as before. */
+void
+page_init (void)
+{
+  zero_kpage = palloc_get_page (PAL_ZERO);
+}
+
+/* Allocate a page for user and add the page to the supplemental page 
+   table.
    Return the page if successful, otherwise null */
 struct page *page_allocation (void *vaddr, bool read_only)
 {
@@ -25,12 +103,20 @@ struct page *page_allocation (void *vaddr, bool read_only)
   p->read_only = read_only;
   p->private = !read_only;
   p->frame = NULL;
+  p->frame_next = NULL;
+  p->cow = false;
+  p->zero = false;
+  p->advice = PAGE_ADV_NORMAL;
+  p->pinned = false;
+  p->referenced = false;
   p->file = NULL;
   p->thread = cur;
   p->sector = (block_sector_t) - 1;
+  p->readahead = false;
+  p->prefetched = false;
   
   /* Add this page to current thread's page table. */
-  if (hash_insert (cur->sup_page_table, &p->hash_elem) == NULL)
+  if (spt_insert (cur->sup_page_table, p))
     return p;
   /* If the page is already in the page table, free the page and return 
      null. */
@@ -38,23 +124,6 @@ struct page *page_allocation (void *vaddr, bool read_only)
   return NULL;
 }
 
-/* Return the hash value */
-unsigned
-page_get_hash (const struct hash_elem *e, void *aux UNUSED)
-{
-  const struct page *p = hash_entry (e, struct page, hash_elem);
-  return ((uintptr_t) p->vaddr) >> PGBITS;
-}
-
-/* Hash comparison helper function */
-bool
-page_less (const struct hash_elem *a, const struct hash_elem *b,
-           void *aux UNUSED)
-{
-  return hash_entry (a, struct page, hash_elem)->vaddr 
-         < hash_entry (b, struct page, hash_elem)->vaddr;
-}
-
 /* Zero the page. Helper function for loading page. */
 void
 zeroing_page (struct page *p)
@@ -73,41 +142,489 @@ load_from_file (struct page *p)
   memset (p->frame->kernel_virtual_address + read_bytes, 0, zero_bytes);
 }
 
+/* Returns true if page P is a read-only file page that processes 
+   running the same file can share through the page cache. */
+static bool
+page_cacheable (struct page *p)
+{
+  return p->read_only && p->file != NULL 
+         && p->sector == (block_sector_t) -1;
+}
+
+/* Record whether read-ahead page P was used before it left memory, and 
+   adapt the read-ahead window to match. */
+static void
+page_readahead_done (struct page *p, bool hit)
+{
+  p->readahead = false;
+  if (hit)
+    {
+      swap_ra_hit_cnt++;
+      if (swap_ra_window < SWAP_RA_MAX)
+        swap_ra_window++;
+    }
+  else
+    {
+      swap_ra_miss_cnt++;
+      if (swap_ra_window > SWAP_RA_MIN)
+        swap_ra_window--;
+    }
+}
+
+/* Returns the current thread's page at VADDR if it is swapped out, 
+   otherwise null. */
+static struct page *
+swapped_page (uint8_t *vaddr)
+{
+  if (!is_user_vaddr (vaddr) || vaddr < (uint8_t *) PGSIZE)
+    return NULL;
+  struct page *p = page_lookup (vaddr);
+  if (p == NULL || p->frame != NULL || p->sector == (block_sector_t) -1)
+    return NULL;
+  return p;
+}
+
+/* Load swapped-out page P, whose frame is allocated and locked, along
+   with swapped-out neighbours of P in the current thread, reading all
+   of them with one clustered swap read.  Neighbours only get free 
+   frames, and they are mapped right away so that touching them does 
+   not fault. */
+static void
+page_swap_in (struct page *p)
+{
+  struct page *pages[SWAP_RA_MAX];
+  size_t window = swap_ra_window;
+  size_t cnt = 0;
+  size_t i;
+
+  /* Follow madvise() advice over the adaptive window. */
+  if (p->advice == PAGE_ADV_RANDOM)
+    window = 1;
+  else if (p->advice == PAGE_ADV_SEQUENTIAL)
+    window = SWAP_RA_MAX;
+
+  pages[cnt++] = p;
+  for (i = 1; i < window && cnt < window; i++)
+    {
+      /* Look both ways, the next pages first. */
+      uint8_t *ahead = (uint8_t *) p->vaddr + i * PGSIZE;
+      uint8_t *behind = (uint8_t *) p->vaddr - i * PGSIZE;
+      struct page *candidates[2];
+      candidates[0] = swapped_page (ahead);
+      candidates[1] = p->advice != PAGE_ADV_SEQUENTIAL
+                      && (uintptr_t) p->vaddr > i * PGSIZE
+                      ? swapped_page (behind) : NULL;
+
+      for (int c = 0; c < 2 && cnt < window; c++)
+        {
+          struct page *q = candidates[c];
+          if (q == NULL)
+            continue;
+          q->frame = frame_allocation_free (q);
+          if (q->frame == NULL)
+            /* Out of free frames, stop here. */
+            goto read;
+          pages[cnt++] = q;
+        }
+    }
+
+ read:
+  swap_in_batch (pages, cnt);
+  for (i = 1; i < cnt; i++)
+    {
+      struct page *q = pages[i];
+      if (pagedir_set_page (thread_current ()->pagedir, q->vaddr,
+                            q->frame->kernel_virtual_address, 
+                            !q->read_only))
+        {
+          q->readahead = true;
+          swap_ra_cnt++;
+        }
+      frame_release_lock (q);
+    }
+}
+
+/* Returns the current thread's page at VADDR if it is the page of FILE 
+   at offset OFS and is not in memory, otherwise null. */
+static struct page *
+unloaded_file_page (uint8_t *vaddr, struct file *file, off_t ofs)
+{
+  if (!is_user_vaddr (vaddr))
+    return NULL;
+  struct page *p = find_page (vaddr, false);
+  if (p == NULL || p->frame != NULL || p->sector != (block_sector_t) -1
+      || p->file != file || p->file_offset != ofs)
+    return NULL;
+  return p;
+}
+
+/* Returns true if the fault on file page P continues a sequential scan, 
+   that is the page before it maps the previous page of the same file 
+   and is already in memory. */
+static bool
+page_sequential (struct page *p)
+{
+  if ((uintptr_t) p->vaddr < PGSIZE)
+    return false;
+  struct page *prev = page_lookup ((uint8_t *) p->vaddr - PGSIZE);
+  return prev != NULL && prev->frame != NULL && prev->file == p->file
+         && prev->file_offset + PGSIZE == p->file_offset;
+}
+
+/* File page P has just been loaded.  If faults on its file are 
+   sequential, read up to FILE_RA_PAGES following pages of the same file 
+   into free frames, never more than there are free frames.  They are 
+   left unmapped, the fault on them only has to install the mapping. 
+   Pages advised sequential read FILE_RA_SEQ_PAGES ahead without 
+   waiting for a second fault, pages advised random none. */
+static void
+page_file_readahead (struct page *p)
+{
+  size_t window = FILE_RA_PAGES;
+  size_t free_cnt = frame_free_count ();
+
+  if (p->advice == PAGE_ADV_SEQUENTIAL)
+    window = FILE_RA_SEQ_PAGES;
+  else if (p->advice == PAGE_ADV_RANDOM || !page_sequential (p))
+    return;
+  if (window > free_cnt)
+    window = free_cnt;
+
+  for (size_t i = 1; i <= window; i++)
+    {
+      struct page *q = unloaded_file_page ((uint8_t *) p->vaddr + i * PGSIZE,
+                                           p->file,
+                                           p->file_offset + i * PGSIZE);
+      if (q == NULL)
+        break;
+      q->frame = frame_allocation_free (q);
+      if (q->frame == NULL)
+        break;
+      load_from_file (q);
+      if (page_cacheable (q))
+        frame_cache_insert (q->frame, file_get_inode (q->file),
+                            q->file_offset, q->file_bytes);
+      q->prefetched = true;
+      file_ra_cnt++;
+      frame_release_lock (q);
+    }
+}
+
+/* Read the CNT file pages in RUN, which follow each other in memory 
+   and in their file, with one file read through their user addresses. 
+   Their frames are locked and mapped writable, so that the kernel can 
+   write them.  Read-only pages are write-protected afterwards. */
+static void
+page_eager_run (struct page **run, size_t cnt)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  off_t bytes = 0;
+  off_t read;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  for (i = 0; i < cnt; i++)
+    bytes += run[i]->file_bytes;
+  read = file_read_at (run[0]->file, run[0]->vaddr, bytes, 
+                       run[0]->file_offset);
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = run[i];
+      off_t ofs = (off_t) i * PGSIZE;
+      off_t got = read > ofs ? read - ofs : 0;
+
+      if (got > PGSIZE)
+        got = PGSIZE;
+      memset (p->frame->kernel_virtual_address + got, 0, PGSIZE - got);
+      /* The page still matches its file. */
+      pagedir_set_dirty (pd, p->vaddr, false);
+      if (p->read_only)
+        pagedir_set_writable (pd, p->vaddr, false);
+      if (page_cacheable (p))
+        frame_cache_insert (p->frame, file_get_inode (p->file),
+                            p->file_offset, p->file_bytes);
+      frame_release_lock (p);
+    }
+  eager_page_cnt += cnt;
+  eager_read_cnt++;
+}
+
+/* Read the file pages of the current thread from START, which must be 
+   page-aligned, through the SIZE bytes after it into free frames and 
+   map them, for exec of a small program.  Pages another process has 
+   cached are shared, the others are read EAGER_RUN_MAX at a time with 
+   one file read.  Stops when no frame is free, the remaining pages 
+   are loaded on their first use as usual. */
+void
+page_load_eager (void *start, size_t size)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *run[EAGER_RUN_MAX];
+  size_t cnt = 0;
+  uint8_t *upage;
+
+  for (upage = start; upage < (uint8_t *) start + size; upage += PGSIZE)
+    {
+      struct page *p = find_page (upage, false);
+      if (p == NULL || p->frame != NULL || p->file == NULL)
+        break;
+
+      if (page_cacheable (p))
+        p->frame = frame_cache_share (p, file_get_inode (p->file),
+                                      p->file_offset, p->file_bytes);
+      if (p->frame == NULL)
+        {
+          p->frame = frame_allocation_free (p);
+          if (p->frame == NULL)
+            break;
+          if (pagedir_set_page (pd, p->vaddr, 
+                                p->frame->kernel_virtual_address, true))
+            {
+              run[cnt++] = p;
+              if (cnt == EAGER_RUN_MAX || p->file_bytes < PGSIZE)
+                {
+                  page_eager_run (run, cnt);
+                  cnt = 0;
+                }
+              continue;
+            }
+          /* Out of memory for a page table, leave the mapping to the 
+             fault like for a read-ahead page. */
+          load_from_file (p);
+          if (page_cacheable (p))
+            frame_cache_insert (p->frame, file_get_inode (p->file),
+                                p->file_offset, p->file_bytes);
+        }
+
+      /* The run is broken here. */
+      page_eager_run (run, cnt);
+      cnt = 0;
+      if (!pagedir_set_page (pd, p->vaddr, 
+                             p->frame->kernel_virtual_address, 
+                             !p->read_only))
+        p->prefetched = true;
+      eager_page_cnt++;
+      frame_release_lock (p);
+    }
+  page_eager_run (run, cnt);
+}
+
 bool
 page_load_helper (struct page *p)
 {
   bool success;
   frame_acquire_lock (p);
+  if (p->frame == NULL && page_cacheable (p))
+    /* Another process running the same file may have the page in 
+       memory already. */
+    p->frame = frame_cache_share (p, file_get_inode (p->file),
+                                  p->file_offset, p->file_bytes);
   if (p->frame == NULL)
     {
       /* Allocate a frame for page p. */
       p->frame = frame_allocation (p);
       if (p->frame == NULL)
         return false;
+      p->cow = false;
       /* Copy data into the frame. */
       if (p->sector != (block_sector_t) -1)
-        /* Load data from swap. */
-        swap_in (p);
+        /* Load data from swap, reading ahead. */
+        page_swap_in (p);
       else if (p->file != NULL)
-        /* Load data from the file. */
-        load_from_file (p);
+        {
+          /* Load data from the file, reading ahead. */
+          load_from_file (p);
+          if (page_cacheable (p))
+            frame_cache_insert (p->frame, file_get_inode (p->file),
+                                p->file_offset, p->file_bytes);
+          page_file_readahead (p);
+        }
       else
         /* Zero the page. */
         zeroing_page(p);
       success = true;
     }
-  /* Install frame into page table. */
+  else if (p->prefetched)
+    {
+      /* Read ahead from file, only the mapping is missing. */
+      p->prefetched = false;
+      file_ra_hit_cnt++;
+    }
+  /* Install frame into page table.  A page still shared after fork () 
+     stays read-only until it is written. */
   success = pagedir_set_page (thread_current ()->pagedir, p->vaddr,
                               p->frame->kernel_virtual_address, 
-                              !p->read_only);
+                              !p->read_only && !p->cow);
   /* Release frame. */
   frame_release_lock (p);
   return success;
 }
 
-/* Lazy loading, page load in and return if successed. */
+/* Map the shared zero page read-only at P, an untouched anonymous page 
+   of the current thread, on a read fault.  A write to it later gets a 
+   frame of its own in page_cow ().  Returns false if P needs a frame 
+   right away. */
+static bool
+page_map_zero (struct page *p)
+{
+  if (zero_kpage == NULL || p->frame != NULL || p->file != NULL 
+      || p->sector != (block_sector_t) -1)
+    return false;
+  if (!pagedir_set_page (thread_current ()->pagedir, p->vaddr, zero_kpage,
+                         false))
+    return false;
+  p->zero = true;
+  zero_map_cnt++;
+  return true;
+}
+
+/* If the current thread's page at VADDR, in region R, is in memory 
+   but not mapped, lock its frame and return it.  A read-only file page 
+   not used yet is created if another process has it in the page cache. 
+   Never waits for a frame lock.  Otherwise returns null. */
+static struct page *
+page_resident (struct region *r, uint8_t *vaddr)
+{
+  struct page *q = page_lookup (vaddr);
+  struct frame *f;
+
+  if (q == NULL)
+    {
+      if (!r->read_only || r->file == NULL)
+        return NULL;
+      q = find_page (vaddr, false);
+      if (q == NULL || !page_cacheable (q))
+        return NULL;
+      q->frame = frame_cache_share (q, file_get_inode (q->file),
+                                    q->file_offset, q->file_bytes);
+      return q->frame != NULL ? q : NULL;
+    }
+
+  f = q->frame;
+  if (f == NULL 
+      || pagedir_get_page (thread_current ()->pagedir, vaddr) != NULL
+      || !lock_try_acquire (&f->frame_inuse))
+    return NULL;
+  if (q->frame != f)
+    {
+      /* Evicted meanwhile. */
+      lock_release (&f->frame_inuse);
+      return NULL;
+    }
+  return q;
+}
+
+/* Page P has just been loaded on a fault.  Map the pages around it, in 
+   the aligned block of page_fault_around pages and in the same region, 
+   that are already in memory: read ahead, shared text, or unmapped by 
+   the clock.  Touching them later then does not fault.  The mappings 
+   are installed with the accessed bit clear, so that pages never used 
+   are still the first to go. */
+static void
+page_map_around (struct page *p)
+{
+  struct region *r;
+  uint8_t *start, *end, *upage;
+  size_t block = page_fault_around * PGSIZE;
+
+  if (page_fault_around < 2 || (r = region_find (p->vaddr)) == NULL)
+    return;
+  start = (uint8_t *) ((uintptr_t) p->vaddr / block * block);
+  end = start + block;
+  if (start < r->start)
+    start = r->start;
+  if (end > r->end)
+    end = r->end;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *q;
+
+      if (upage == p->vaddr || (q = page_resident (r, upage)) == NULL)
+        continue;
+      if (pagedir_set_page (thread_current ()->pagedir, upage,
+                            q->frame->kernel_virtual_address,
+                            !q->read_only && !q->cow))
+        {
+          q->prefetched = false;
+          fault_around_cnt++;
+        }
+      frame_release_lock (q);
+    }
+}
+
+/* If page_large is set and the CPU has 4 MB pages, map the aligned 
+   block of PTSPAN bytes around P, an untouched page of the current 
+   thread, with one large page of zeroed frames.  The block must lie in 
+   the zero-filled part of a writable region and have no other pages 
+   yet.  All of its pages are created and given a frame.  Returns false 
+   if P has to be loaded on its own, though P may have its frame by 
+   then. */
+static bool
+page_map_large (struct page *p)
+{
+  struct thread *cur = thread_current ();
+  uint8_t *start = (uint8_t *) ((uintptr_t) p->vaddr / PTSPAN * PTSPAN);
+  struct page **pages, **leaf;
+  struct region *r;
+  struct frame *f;
+  bool success;
+  size_t i;
+
+  if (!page_large || !pse_enabled
+      || p->frame != NULL || p->file != NULL || p->zero
+      || p->sector != (block_sector_t) -1 
+      || frame_free_count () < LARGE_PAGE_CNT)
+    return false;
+  r = region_find (p->vaddr);
+  if (r == NULL || r->read_only || start < r->start + r->file_bytes 
+      || start + PTSPAN > r->end)
+    return false;
+  leaf = cur->sup_page_table->leaves[pd_no (start)];
+  for (i = 0; i < LARGE_PAGE_CNT; i++)
+    if (leaf[i] != NULL && leaf[i] != p)
+      return false;
+
+  pages = palloc_get_page (0);
+  if (pages == NULL)
+    return false;
+  for (i = 0; i < LARGE_PAGE_CNT; i++)
+    {
+      /* Pages created here and not given a frame are still fine to 
+         load one at a time. */
+      pages[i] = find_page (start + i * PGSIZE, false);
+      if (pages[i] == NULL)
+        break;
+    }
+  f = i == LARGE_PAGE_CNT ? frame_allocation_large (pages) : NULL;
+  if (f == NULL)
+    {
+      palloc_free_page (pages);
+      return false;
+    }
+
+  for (i = 0; i < LARGE_PAGE_CNT; i++)
+    {
+      pages[i]->frame = &f[i];
+      zeroing_page (pages[i]);
+    }
+  /* Without the large page, P is mapped by the caller and the other 
+     pages as they are touched, since they already have frames. */
+  success = pagedir_set_large (cur->pagedir, start, 
+                               f->kernel_virtual_address, true);
+  if (success)
+    large_map_cnt++;
+  for (i = 0; i < LARGE_PAGE_CNT; i++)
+    frame_release_lock (pages[i]);
+  palloc_free_page (pages);
+  return success;
+}
+
+/* Lazy loading, page load in and return if successed.  WRITE tells 
+   whether the faulting access was a write. */
 bool
-page_load (void *fault_addr)
+page_load (void *fault_addr, bool write)
 {
   struct page *p;
   /* if current thread do not have any pages, return false */
@@ -119,43 +636,244 @@ page_load (void *fault_addr)
   p = find_page (fault_addr, true);
   if (p == NULL)
     return false;
+
+  fault_cnt++;
+
+  if (page_map_large (p))
+    return true;
+
+  /* Reading an untouched anonymous page needs no frame yet. */
+  if (!write && page_map_zero (p))
+    return true;
   
-  return page_load_helper (p);
+  if (!page_load_helper (p))
+    return false;
+  page_map_around (p);
+  return true;
+}
+
+/* Unpin page P, whose frame is locked, if mlock () pinned it. */
+static void
+page_unpin (struct page *p)
+{
+  if (p->pinned)
+    {
+      p->pinned = false;
+      p->frame->pin_cnt--;
+      p->thread->pinned_cnt--;
+    }
+}
+
+/* Take page P, of a process killed for memory, out of its frame, 
+   which is locked, and unmap it.  Nothing is written to swap, but dirty 
+   pages of a shared file mapping are written back to the file. */
+void
+page_drop (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  struct frame *f = p->frame;
+
+  if (p->readahead)
+    page_readahead_done (p, false);
+  p->prefetched = false;
+  page_unpin (p);
+  if (!page_to_swap (p) && pagedir_is_dirty (pd, p->vaddr))
+    page_writeback (p);
+  pagedir_clear_page (pd, p->vaddr);
+  frame_remove_page (f, p);
 }
 
 /* Destroys a page, which must be in the current process's
-   page table.  Used as a callback for hash_destroy(). */
+   page table.  Used as a callback for spt_destroy(). */
 static void
-page_exit_action (struct hash_elem *page_element, void *aux UNUSED)
+page_exit_action (struct page *p)
 {
-  struct page *p = hash_entry (page_element, struct page, hash_elem);
   frame_acquire_lock (p);
   /* reset the frame if exist. */
   if (p->frame)
     {
-      /* Also remove the page from the frame. */
-      p->frame->page = NULL;
-      frame_release_lock (p);
+      /* Also remove the page from the frame and return the frame to the 
+         free list, unless a forked process still shares it. */
+      struct frame *f = p->frame;
+      page_unpin (p);
+      frame_remove_page (f, p);
+      lock_release (&f->frame_inuse);
     }
+  /* Give back the swap slot, or the system runs out of them as 
+     processes come and go. */
+  swap_drop (p);
   free (p);
 }
 
 void
 page_exit (void)
 {
-  struct hash *h = thread_current ()->sup_page_table;
-  if (h != NULL)
-    hash_destroy (h, page_exit_action);
+  struct thread *cur = thread_current ();
+  struct sup_page_table *spt = cur->sup_page_table;
+  if (spt != NULL)
+    {
+      /* Out of sight of the OOM killer, which looks at other 
+         threads' tables, before the pages go. */
+      oom_exit ();
+      /* Unmap them all at once, freeing the page tables, rather than 
+         leaving the frames mapped after they have been handed out 
+         again. */
+      if (cur->pagedir != NULL)
+        pagedir_clear_range (cur->pagedir, NULL, PHYS_BASE);
+      spt_destroy (spt, page_exit_action);
+    }
 }
 
 /* Returns true if the page is accessed, false otherwise. */
 bool
 page_check_accessed (struct page *p)
 {
-  bool accessed = pagedir_is_accessed (p->thread->pagedir, p->vaddr);
+  bool accessed = pagedir_is_accessed (p->thread->pagedir, p->vaddr)
+                  || p->referenced;
   if (accessed)
-    pagedir_set_accessed (p->thread->pagedir, p->vaddr, false);
-  return accessed;
+    {
+      pagedir_set_accessed (p->thread->pagedir, p->vaddr, false);
+      p->referenced = false;
+      if (p->readahead)
+        page_readahead_done (p, true);
+    }
+  /* A sequential scan is done with a page once it moved past it, so 
+     the page gets no second chance. */
+  return accessed && p->advice != PAGE_ADV_SEQUENTIAL;
+}
+
+/* Returns true if page P, whose frame is locked, was accessed since 
+   the last working-set scan.  The accessed bit is cleared for the next 
+   scan but kept in P for page_check_accessed (). */
+bool
+page_sample_accessed (struct page *p)
+{
+  if (!pagedir_is_accessed (p->thread->pagedir, p->vaddr))
+    return false;
+  pagedir_set_accessed (p->thread->pagedir, p->vaddr, false);
+  p->referenced = true;
+  return true;
+}
+
+/* Count page P into (DELTA 1) or out of (DELTA -1) its thread's 
+   resident set, as it gets or loses a frame.  Evicting threads update 
+   other threads' counts, hence interrupts are off meanwhile. */
+void
+page_rss_add (struct page *p, int delta)
+{
+  enum intr_level old_level = intr_disable ();
+  p->thread->rss += delta;
+  intr_set_level (old_level);
+}
+
+/* Returns true if page P has to be written to swap or to its file before 
+   its frame can be reused, false if the frame can simply be dropped. 
+   P's frame must be locked. */
+bool
+page_is_dirty (struct page *p)
+{
+  if (pagedir_is_dirty (p->thread->pagedir, (const void *) p->vaddr))
+    return true;
+  /* A clean anonymous page still needs writing unless swap already holds 
+     a copy of it. */
+  return p->file == NULL && p->sector == (block_sector_t) -1;
+}
+
+/* Write page P to swap or to its file while leaving it mapped, so that a 
+   later eviction finds it clean.  P's frame must be locked. */
+bool
+page_writeback (struct page *p)
+{
+  /* Clear the dirty bit before copying, so that a write racing with the 
+     copy marks the page dirty again instead of being lost. */
+  pagedir_set_dirty (p->thread->pagedir, p->vaddr, false);
+
+  if (p->file != NULL && !p->private)
+    /* Memory-mapped file page, write it back to file. */
+    return file_write_at (p->file, 
+                          (const void *) p->frame->kernel_virtual_address, 
+                          p->file_bytes, p->file_offset) == p->file_bytes;
+
+  /* Anonymous or private page, write it to swap. */
+  if (swap_out (p))
+    return true;
+  pagedir_set_dirty (p->thread->pagedir, p->vaddr, true);
+  return false;
+}
+
+/* Returns true if page P goes to swap rather than to a file when it is 
+   written back. */
+bool
+page_to_swap (struct page *p)
+{
+  return p->file == NULL || p->private;
+}
+
+/* Write the CNT swap-backed pages in PAGES to swap with one batched 
+   swap write, leaving them mapped.  Their frames must be locked. 
+   Returns the number of pages written. */
+size_t
+page_writeback_batch (struct page **pages, size_t cnt)
+{
+  size_t i;
+
+  /* Clear the dirty bits before copying, see page_writeback (). */
+  for (i = 0; i < cnt; i++)
+    pagedir_set_dirty (pages[i]->thread->pagedir, pages[i]->vaddr, false);
+
+  size_t done = swap_out_batch (pages, cnt);
+  if (done < cnt)
+    for (i = 0; i < cnt; i++)
+      if (pages[i]->sector == (block_sector_t) -1)
+        pagedir_set_dirty (pages[i]->thread->pagedir, pages[i]->vaddr, true);
+  return done;
+}
+
+/* Map page P, which could not be written out on eviction and keeps its 
+   locked frame, back in.  A fault would map it with a clean page table 
+   entry and its changes would be dropped on the next eviction, so the 
+   dirty bit is set again. */
+static void
+page_evict_failed (struct page *p)
+{
+  pagedir_set_page (p->thread->pagedir, p->vaddr, 
+                    p->frame->kernel_virtual_address, 
+                    !p->read_only && !p->cow);
+  pagedir_set_dirty (p->thread->pagedir, p->vaddr, true);
+}
+
+/* Evict the CNT dirty, swap-backed pages in PAGES with one batched swap 
+   write.  Their frames must be locked.  A page that could not be 
+   written keeps its frame, the others have their frame cleared. 
+   Returns the number of pages evicted. */
+size_t
+page_evict_batch (struct page **pages, size_t cnt)
+{
+  size_t i;
+
+  /* Clear the pages from their page tables. Later accesses will fault. */
+  for (i = 0; i < cnt; i++)
+    {
+      if (pages[i]->readahead)
+        page_readahead_done (pages[i], false);
+      pagedir_clear_page (pages[i]->thread->pagedir, pages[i]->vaddr);
+    }
+
+  size_t done = swap_out_batch (pages, cnt);
+  for (i = 0; i < cnt; i++)
+    if (pages[i]->sector != (block_sector_t) -1)
+      {
+        /* The dirty bit is used up, clearing it lets the page table 
+           go once empty. */
+        pagedir_set_dirty (pages[i]->thread->pagedir, pages[i]->vaddr, 
+                           false);
+        /* free the frame */
+        pages[i]->frame = NULL;
+        page_rss_add (pages[i], -1);
+      }
+    else
+      page_evict_failed (pages[i]);
+  return done;
 }
 
 bool
@@ -164,6 +882,11 @@ page_evict (struct page *p)
     /* Determine if a write is done to the page. */
   bool dirty = pagedir_is_dirty (p->thread->pagedir, (const void *) p->vaddr);
 
+  if (p->readahead)
+    /* Read ahead but never used. */
+    page_readahead_done (p, false);
+  p->prefetched = false;
+
   /* Clear the page from the page table. Later accesses to the page will 
      fault*/
   pagedir_clear_page (p->thread->pagedir, (void *) p->vaddr);
@@ -171,9 +894,13 @@ page_evict (struct page *p)
   bool success = !dirty;
   
   if (p->file == NULL)
-    /* If the page has no file associated with it, then it must be swapped 
-       out. */
-    success = swap_out (p);
+    {
+      /* If the page has no file associated with it, then it must be 
+         swapped out, unless it is clean and was already written back to 
+         swap. */
+      if (dirty || p->sector == (block_sector_t) -1)
+        success = swap_out (p);
+    }
   else if (dirty) 
     {
       /* If the page is dirty and has a file associated with it, then we 
@@ -191,33 +918,365 @@ page_evict (struct page *p)
     }
 
   if (success)
-    /* free the frame */
-    p->frame = NULL;
+    {
+      /* The dirty bit is used up, clearing it lets the page table go 
+         once empty. */
+      if (dirty)
+        pagedir_set_dirty (p->thread->pagedir, p->vaddr, false);
+      /* free the frame */
+      p->frame = NULL;
+      page_rss_add (p, -1);
+    }
+  else
+    page_evict_failed (p);
+  return success;
+}
+
+/* Evict the page in a frame shared after fork (), HEAD being the first 
+   of its sharers, and take every sharer out of the frame.  If any of 
+   them has to be written out, HEAD goes to swap once and the others 
+   share its swap slot.  The frame must be locked. */
+bool
+page_evict_shared (struct page *head)
+{
+  bool dirty = false;
+  struct page *p;
+
+  /* Clear the pages from their page tables. Later accesses will fault. */
+  for (p = head; p != NULL; p = p->frame_next)
+    {
+      if (p->readahead)
+        page_readahead_done (p, false);
+      p->prefetched = false;
+      if (page_is_dirty (p))
+        dirty = true;
+      pagedir_clear_page (p->thread->pagedir, p->vaddr);
+    }
+
+  if (dirty)
+    {
+      for (p = head; p != NULL; p = p->frame_next)
+        swap_drop (p);
+      if (!swap_out (head))
+        return false;
+      for (p = head->frame_next; p != NULL; p = p->frame_next)
+        {
+          swap_share (p, head->sector);
+          p->file = NULL;
+          p->file_offset = 0;
+          p->file_bytes = 0;
+          p->private = false;
+        }
+    }
+
+  /* Free the frame.  Each page gets its own frame when loaded again. */
+  while (head != NULL)
+    {
+      p = head->frame_next;
+      pagedir_set_dirty (head->thread->pagedir, head->vaddr, false);
+      head->frame = NULL;
+      head->frame_next = NULL;
+      page_rss_add (head, -1);
+      head->cow = false;
+      head = p;
+    }
+  return true;
+}
+
+/* Give page P, mapped to the shared zero page, a zeroed frame of its 
+   own and map it writable.  P's frame lock is not held, it has none. */
+static bool
+page_unzero (struct page *p)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  bool success;
+
+  p->frame = frame_allocation (p);
+  if (p->frame == NULL)
+    return false;
+  zeroing_page (p);
+  pagedir_clear_page (pd, p->vaddr);
+  success = pagedir_set_page (pd, p->vaddr, 
+                              p->frame->kernel_virtual_address, true);
+  p->zero = false;
+  zero_copy_cnt++;
+  frame_release_lock (p);
   return success;
 }
 
+/* Resolve a write fault at FAULT_ADDR on a copy-on-write page of the 
+   current thread.  While other pages share its frame the page gets a 
+   copy in a frame of its own, then it is mapped writable.  A page 
+   mapped to the shared zero page gets a zeroed frame instead.  Returns 
+   false if the fault is not a copy-on-write fault or no frame could 
+   be had. */
+bool
+page_cow (void *fault_addr)
+{
+  struct thread *cur = thread_current ();
+  struct page *p;
+
+  if (cur->sup_page_table == NULL || !is_user_vaddr (fault_addr))
+    return false;
+  p = find_page (fault_addr, false);
+  if (p == NULL || p->read_only)
+    return false;
+
+  frame_acquire_lock (p);
+  if (p->frame == NULL)
+    /* Either the zero page is mapped there, or the page was evicted 
+       meanwhile, then retry and let the page be loaded again. */
+    return p->zero ? page_unzero (p) : true;
+  if (!p->cow)
+    {
+      frame_release_lock (p);
+      return false;
+    }
+
+  struct frame *old = p->frame;
+  if (old->page_cnt > 1)
+    {
+      /* Copy the contents out of the shared frame, which stays locked 
+         so that the clock cannot take it meanwhile. */
+      frame_remove_page (old, p);
+      p->frame = frame_allocation_free (p);
+      if (p->frame == NULL)
+        {
+          /* Making room may evict, and the clock must not find OLD 
+             locked by this thread.  Keep a copy of the contents and let 
+             go of OLD first. */
+          void *copy = palloc_get_page (0);
+          if (copy == NULL)
+            {
+              frame_share (old, p);
+              lock_release (&old->frame_inuse);
+              return false;
+            }
+          memcpy (copy, old->kernel_virtual_address, PGSIZE);
+          if (p->pinned)
+            old->pin_cnt--;
+          pagedir_clear_page (cur->pagedir, p->vaddr);
+          lock_release (&old->frame_inuse);
+
+          p->frame = frame_allocation (p);
+          if (p->frame != NULL)
+            memcpy (p->frame->kernel_virtual_address, copy, PGSIZE);
+          palloc_free_page (copy);
+          if (p->frame == NULL)
+            return false;
+        }
+      else
+        {
+          memcpy (p->frame->kernel_virtual_address, 
+                  old->kernel_virtual_address, PGSIZE);
+          if (p->pinned)
+            old->pin_cnt--;
+          lock_release (&old->frame_inuse);
+          pagedir_clear_page (cur->pagedir, p->vaddr);
+        }
+      if (p->pinned)
+        /* The pin moves along with the page. */
+        p->frame->pin_cnt++;
+
+      if (!pagedir_set_page (cur->pagedir, p->vaddr, 
+                             p->frame->kernel_virtual_address, true))
+        {
+          frame_release_lock (p);
+          return false;
+        }
+      /* The copy exists nowhere else yet. */
+      pagedir_set_dirty (cur->pagedir, p->vaddr, true);
+    }
+  else
+    /* The last page left in the frame, just let it write. */
+    pagedir_set_writable (cur->pagedir, p->vaddr, true);
+
+  p->cow = false;
+  frame_release_lock (p);
+  return true;
+}
+
+/* Returns true if page P, whose frame is locked, holds anonymous or 
+   private data that may share a frame with identical pages. */
+bool
+page_mergeable (struct page *p)
+{
+  return !p->read_only && !p->pinned && page_to_swap (p);
+}
+
+/* Map page P, whose frame is locked, read-only so that its next write 
+   takes a copy-on-write fault. */
+void
+page_protect (struct page *p)
+{
+  if (!p->cow)
+    {
+      p->cow = true;
+      pagedir_set_writable (p->thread->pagedir, p->vaddr, false);
+    }
+}
+
+/* Undo page_protect () on page P, whose locked frame holds P alone, 
+   letting it write again without a fault. */
+void
+page_unprotect (struct page *p)
+{
+  ASSERT (p->frame->page_cnt == 1);
+  if (p->cow)
+    {
+      p->cow = false;
+      pagedir_set_writable (p->thread->pagedir, p->vaddr, true);
+    }
+}
+
+/* Move page P, write-protected by page_protect (), out of its frame 
+   into frame TO, which holds the same contents.  Both frames must be 
+   locked.  P's frame goes to the free list if P was the last page in 
+   it. */
+void
+page_remap (struct page *p, struct frame *to)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool dirty = pagedir_is_dirty (pd, p->vaddr);
+
+  frame_remove_page (p->frame, p);
+  pagedir_clear_page (pd, p->vaddr);
+  frame_share (to, p);
+  /* Failing to map is fine, the next access will.  The dirty bit still 
+     tells whether the contents differ from P's file or swap slot. */
+  pagedir_set_page (pd, p->vaddr, to->kernel_virtual_address, false);
+  if (dirty)
+    pagedir_set_dirty (pd, p->vaddr, true);
+}
+
+/* Copy the parent's page PP into the current thread, for page_fork().
+   Returns false if out of memory. */
+static bool
+page_fork_page (struct page *pp, void *parent_)
+{
+  struct thread *parent = parent_;
+  struct thread *cur = thread_current ();
+  struct page *p = page_allocation (pp->vaddr, pp->read_only);
+  if (p == NULL)
+    return false;
+
+  frame_acquire_lock (pp);
+  p->private = pp->private;
+  p->advice = pp->advice;
+  p->file = pp->file != NULL ? files_fork_file (parent, pp->file) : NULL;
+  p->file_offset = pp->file_offset;
+  p->file_bytes = pp->file_bytes;
+
+  if (pp->frame != NULL && !pp->read_only && !page_to_swap (pp))
+    {
+      /* Memory-mapped file page, the child reads the file. */
+      if (pagedir_is_dirty (parent->pagedir, pp->vaddr))
+        page_writeback (pp);
+    }
+  else if (pp->frame != NULL)
+    {
+      if (!pp->read_only)
+        {
+          /* The frame becomes the only copy of the page, so a slot 
+             written back earlier no longer counts. */
+          swap_drop (pp);
+          pp->cow = true;
+          p->cow = true;
+          pagedir_set_writable (parent->pagedir, pp->vaddr, false);
+        }
+      frame_share (pp->frame, p);
+      /* Failing to map is fine, the first access will. */
+      pagedir_set_page (cur->pagedir, p->vaddr, 
+                        p->frame->kernel_virtual_address, false);
+    }
+  else if (pp->sector != (block_sector_t) -1)
+    swap_share (p, pp->sector);
+  frame_release_lock (pp);
+  return true;
+}
+
+/* Copy the pages of PARENT into the current thread, a child forked from 
+   it whose page table is still empty.  Resident pages are shared with 
+   the parent, writable ones copy-on-write, swapped-out pages share the 
+   parent's swap slot, and the rest stay lazily loaded.  Pages of a 
+   memory-mapped file are written back and loaded again by the child 
+   from its own mapping.  Returns false if out of memory. */
+bool
+page_fork (struct thread *parent)
+{
+  return spt_for_each (parent->sup_page_table, page_fork_page, parent);
+}
+
 /* Clear the page from the page table. */
 void
 page_clear (void *vaddr)
 {
-  struct page *p = find_page (vaddr, true);
+  struct page *p = page_lookup (vaddr);
   if (p)
     {
       /* Clear the page frame if exist. */
+      frame_acquire_lock (p);
       if (p->frame)
         {
-          frame_acquire_lock (p);
-          p->frame->page = NULL;
-          frame_release_lock (p);
+          /* Unmap the page first, the frame goes back to the free list 
+             and will be handed to someone else. */
+          struct frame *f = p->frame;
+          pagedir_clear_page (p->thread->pagedir, p->vaddr);
+          pagedir_set_dirty (p->thread->pagedir, p->vaddr, false);
+          page_unpin (p);
+          frame_remove_page (f, p);
+          lock_release (&f->frame_inuse);
         }
+      swap_drop (p);
       /* Remove the page from the page table. */
-      hash_delete (thread_current ()->sup_page_table, &p->hash_elem);
+      spt_remove (thread_current ()->sup_page_table, p);
       free (p);
     }
 }
 
-/* Find the page containning virtual address ADDRESS if exist. If grow is set 
-   to true, will allocates stack pages if requirements are met */
+/* Returns the current thread's page containing ADDRESS if it exists, 
+   without creating it from a region or growing the stack. */
+struct page *
+page_lookup (const void *address)
+{
+  return spt_find (thread_current ()->sup_page_table, address);
+}
+
+/* Back page P, in region R, with R's file or with zeros, as on its 
+   first use. */
+static void
+page_set_region (struct page *p, struct region *r)
+{
+  off_t ofs = (uint8_t *) p->vaddr - r->start;
+
+  p->private = r->private;
+  p->file = NULL;
+  p->file_offset = 0;
+  p->file_bytes = 0;
+  if (ofs < r->file_bytes)
+    {
+      p->file = r->file;
+      p->file_offset = r->offset + ofs;
+      p->file_bytes = r->file_bytes - ofs < PGSIZE 
+                      ? r->file_bytes - ofs : PGSIZE;
+    }
+}
+
+/* Create the current thread's page at VADDR in region R, on its first 
+   use. */
+static struct page *
+page_from_region (struct region *r, void *vaddr)
+{
+  struct page *p = page_allocation (vaddr, r->read_only);
+
+  if (p != NULL)
+    page_set_region (p, r);
+  return p;
+}
+
+/* Find the page containning virtual address ADDRESS if exist, creating 
+   it if ADDRESS is in a mapped region. If grow is set to true, will 
+   allocates stack pages if requirements are met */
 struct page *
 find_page (const void *address, bool grow)
 {
@@ -226,21 +1285,397 @@ find_page (const void *address, bool grow)
     return NULL;
 
   struct thread *cur = thread_current ();
-  struct page p;
-
-  p.vaddr = (void *) pg_round_down (address);
-  struct hash_elem *elem = hash_find (cur->sup_page_table, &p.hash_elem);
+  void *upage = pg_round_down (address);
+  struct page *p = spt_find (cur->sup_page_table, upage);
 
   /* If the page exist, return the page. */
-  if (elem != NULL)
-    return hash_entry (elem, struct page, hash_elem);
+  if (p != NULL)
+    return p;
+
+  /* Pages of a region are created on first use. */
+  struct region *r = region_find (upage);
+  if (r != NULL)
+    return page_from_region (r, upage);
 
   /* Check if need allocate stack page. */
-  if (grow && (p.vaddr > PHYS_BASE - STACK_MAX) 
-      && ((p.vaddr > (void *) cur->user_esp) 
+  if (grow && (upage > PHYS_BASE - STACK_MAX) 
+      && ((upage > (void *) cur->user_esp) 
       || ((void *) cur->user_esp - 32 == address) 
       || ((void *) cur->user_esp - 4 == address)))
-    return page_allocation (p.vaddr, false);
+    return page_allocation (upage, false);
 
   return NULL;
+}
+
+/* Read the CNT swapped-out pages in PAGES, whose frames are locked, 
+   with one clustered swap read and map them. */
+static void
+page_willneed_swap_in (struct page **pages, size_t cnt)
+{
+  size_t i;
+
+  swap_in_batch (pages, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      pagedir_set_page (thread_current ()->pagedir, pages[i]->vaddr,
+                        pages[i]->frame->kernel_virtual_address,
+                        !pages[i]->read_only);
+      frame_release_lock (pages[i]);
+    }
+}
+
+/* Read the current thread's pages from START up to END that are 
+   swapped out or not yet loaded from their file into free frames, for 
+   madvise (MADV_WILLNEED).  Swapped-out pages are read SWAP_BATCH_MAX 
+   at a time and mapped, file pages are left for their fault to map 
+   like read-ahead pages.  Stops when no frame is free, nothing is 
+   evicted for them. */
+static void
+page_willneed (uint8_t *start, uint8_t *end)
+{
+  struct page *batch[SWAP_BATCH_MAX];
+  size_t cnt = 0;
+  uint8_t *upage;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      if (p->frame != NULL 
+          || (p->sector == (block_sector_t) -1 && p->file == NULL))
+        continue;
+
+      if (page_cacheable (p))
+        p->frame = frame_cache_share (p, file_get_inode (p->file),
+                                      p->file_offset, p->file_bytes);
+      if (p->frame == NULL)
+        {
+          p->frame = frame_allocation_free (p);
+          if (p->frame == NULL)
+            break;
+          p->cow = false;
+          if (p->sector != (block_sector_t) -1)
+            {
+              batch[cnt++] = p;
+              if (cnt == SWAP_BATCH_MAX)
+                {
+                  page_willneed_swap_in (batch, cnt);
+                  cnt = 0;
+                }
+              willneed_cnt++;
+              continue;
+            }
+          load_from_file (p);
+          if (page_cacheable (p))
+            frame_cache_insert (p->frame, file_get_inode (p->file),
+                                p->file_offset, p->file_bytes);
+        }
+      p->prefetched = true;
+      willneed_cnt++;
+      frame_release_lock (p);
+    }
+  if (cnt > 0)
+    page_willneed_swap_in (batch, cnt);
+}
+
+/* Drop the contents of page P of the current thread, for madvise 
+   (MADV_DONTNEED).  Its frame and swap slot are freed right away and 
+   its next access finds it as on its first use, read from its file or 
+   zero-filled.  Dirty pages of a shared file mapping are written back 
+   first, their contents live on in the file. */
+static void
+page_discard (struct page *p)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct region *r;
+
+  frame_acquire_lock (p);
+  if (p->readahead)
+    page_readahead_done (p, false);
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+      if (!page_to_swap (p) && pagedir_is_dirty (pd, p->vaddr))
+        page_writeback (p);
+      pagedir_clear_page (pd, p->vaddr);
+      pagedir_set_dirty (pd, p->vaddr, false);
+      frame_remove_page (f, p);
+      lock_release (&f->frame_inuse);
+    }
+  else if (p->zero)
+    pagedir_clear_page (pd, p->vaddr);
+
+  swap_drop (p);
+  p->zero = false;
+  p->cow = false;
+  p->prefetched = false;
+  r = region_find (p->vaddr);
+  if (r != NULL)
+    page_set_region (p, r);
+  dontneed_cnt++;
+}
+
+/* Find the pages a system call names by ADDR, which must be 
+   page-aligned, and the LENGTH bytes after it.  Stores the first page 
+   in *START and the page after the last in *END.  Returns false if the 
+   range is not in user space. */
+static bool
+page_range (void *addr, size_t length, uint8_t **start, uint8_t **end)
+{
+  if (pg_ofs (addr) != 0 || !is_user_vaddr (addr)
+      || length > (size_t) ((uint8_t *) PHYS_BASE - (uint8_t *) addr))
+    return false;
+  *start = addr;
+  *end = *start + ROUND_UP (length, PGSIZE);
+  return true;
+}
+
+/* Apply madvise() ADVICE to the current thread's pages from ADDR, 
+   which must be page-aligned, through the LENGTH bytes after it. 
+   Returns false if the range is invalid or not all mapped, or if 
+   pages locked by mlock () would be dropped. */
+bool
+page_advise (void *addr, size_t length, enum page_advice advice)
+{
+  uint8_t *start, *end, *upage;
+
+  if (!page_range (addr, length, &start, &end) 
+      || advice > PAGE_ADV_DONTNEED)
+    return false;
+
+  /* Every page must be mapped, pages of regions are created here. */
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *p = find_page (upage, false);
+      if (p == NULL || (advice == PAGE_ADV_DONTNEED && p->pinned))
+        return false;
+    }
+
+  if (advice == PAGE_ADV_WILLNEED)
+    page_willneed (start, end);
+  else
+    for (upage = start; upage < end; upage += PGSIZE)
+      {
+        struct page *p = page_lookup (upage);
+        if (advice == PAGE_ADV_DONTNEED)
+          page_discard (p);
+        else
+          p->advice = advice;
+      }
+  return true;
+}
+
+/* Make page P of the current thread resident in a frame of its own, 
+   copying it if it shares one copy-on-write or is mapped to the zero 
+   page.  It may be evicted again before its frame is locked. */
+static bool
+page_populate (struct page *p)
+{
+  if (p->zero)
+    return page_cow (p->vaddr);
+  if ((p->frame == NULL || p->prefetched) && !page_load_helper (p))
+    return false;
+  if (p->cow && !page_cow (p->vaddr))
+    return false;
+  return true;
+}
+
+/* Fault in the current thread's pages from ADDR, which must be 
+   page-aligned, through the LENGTH bytes after it, and pin them in 
+   their frames for mlock ().  Writable pages get frames of their own 
+   first, so that a copy-on-write fault does not move them later. 
+   Returns false if the range is invalid or not all mapped, if the 
+   thread would pin more than page_mlock_max pages, or if out of 
+   memory.  Pages pinned before a failure stay pinned. */
+bool
+page_mlock (void *addr, size_t length)
+{
+  struct thread *cur = thread_current ();
+  uint8_t *start, *end, *upage;
+  size_t new_cnt = 0;
+
+  if (!page_range (addr, length, &start, &end))
+    return false;
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *p = find_page (upage, false);
+      if (p == NULL)
+        return false;
+      if (!p->pinned)
+        new_cnt++;
+    }
+  if (cur->pinned_cnt + new_cnt > page_mlock_max)
+    {
+      mlock_refused_cnt++;
+      return false;
+    }
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      if (p->pinned)
+        continue;
+
+      /* The clock may take the page again until its frame is locked. */
+      for (;;)
+        {
+          if (!page_populate (p))
+            return false;
+          frame_acquire_lock (p);
+          if (p->frame != NULL && !p->cow && !p->prefetched)
+            break;
+          frame_release_lock (p);
+        }
+      p->pinned = true;
+      p->frame->pin_cnt++;
+      cur->pinned_cnt++;
+      mlock_cnt++;
+      frame_release_lock (p);
+    }
+  return true;
+}
+
+/* Unpin the current thread's pages from ADDR, which must be 
+   page-aligned, through the LENGTH bytes after it, for munlock (). 
+   Pages that are not pinned or not mapped are skipped.  Returns false 
+   if the range is invalid. */
+bool
+page_munlock (void *addr, size_t length)
+{
+  uint8_t *start, *end, *upage;
+
+  if (!page_range (addr, length, &start, &end))
+    return false;
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      if (p != NULL && p->pinned)
+        {
+          frame_acquire_lock (p);
+          page_unpin (p);
+          frame_release_lock (p);
+        }
+    }
+  return true;
+}
+
+/* Write back the CNT dirty pages in RUN, which are consecutive both 
+   in the current thread's memory and in their file, with one file 
+   write, and unlock their frames.  The frames stay locked until then, 
+   so the write reads them through their user addresses.  Like 
+   page_writeback (), this does not take filesys_lock, which system 
+   calls hold while faulting on user pages and locking their frames. */
+static void
+page_sync_run (struct page **run, size_t cnt)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  off_t bytes = 0;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  /* Clear the dirty bits first, see page_writeback (). */
+  for (i = 0; i < cnt; i++)
+    {
+      pagedir_set_dirty (pd, run[i]->vaddr, false);
+      bytes += run[i]->file_bytes;
+    }
+  file_write_at (run[0]->file, run[0]->vaddr, bytes, run[0]->file_offset);
+  for (i = 0; i < cnt; i++)
+    frame_release_lock (run[i]);
+  sync_page_cnt += cnt;
+  sync_write_cnt++;
+}
+
+/* Write back the dirty pages of shared file mappings among the current 
+   thread's pages from START up to END, for msync () and munmap (). 
+   Clean pages and pages not in memory are skipped, evicted pages were 
+   written back already.  Runs of dirty pages that are consecutive in 
+   their file go out with one write.  If ASYNC, the pages are queued 
+   for the page cleaner instead. */
+void
+page_sync (void *start, void *end, bool async)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *run[SYNC_RUN_MAX];
+  size_t cnt = 0;
+  uint8_t *upage;
+
+  for (upage = start; upage < (uint8_t *) end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      struct page *prev = cnt > 0 ? run[cnt - 1] : NULL;
+
+      if (p == NULL || page_to_swap (p))
+        {
+          page_sync_run (run, cnt);
+          cnt = 0;
+          continue;
+        }
+      frame_acquire_lock (p);
+      if (p->frame == NULL || !pagedir_is_dirty (pd, p->vaddr))
+        {
+          frame_release_lock (p);
+          page_sync_run (run, cnt);
+          cnt = 0;
+          continue;
+        }
+      if (async)
+        {
+          frame_schedule_writeback (p->frame);
+          frame_release_lock (p);
+          continue;
+        }
+      if (prev != NULL && (cnt == SYNC_RUN_MAX || prev->file != p->file
+                           || prev->file_offset + PGSIZE != p->file_offset))
+        {
+          page_sync_run (run, cnt);
+          cnt = 0;
+        }
+      run[cnt++] = p;
+    }
+  page_sync_run (run, cnt);
+}
+
+/* Write back the dirty pages of shared file mappings from ADDR, which 
+   must be page-aligned, through the LENGTH bytes after it, for 
+   msync ().  Returns false if the range is invalid or not all 
+   mapped. */
+bool
+page_msync (void *addr, size_t length, bool async)
+{
+  uint8_t *start, *end, *upage;
+
+  if (!page_range (addr, length, &start, &end))
+    return false;
+  for (upage = start; upage < end; upage += PGSIZE)
+    if (page_lookup (upage) == NULL && region_find (upage) == NULL)
+      return false;
+  page_sync (start, end, async);
+  return true;
+}
+
+/* Prints paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Swap read-ahead: %lld pages, %lld hits, %lld misses, "
+          "window %zu\n", swap_ra_cnt, swap_ra_hit_cnt, swap_ra_miss_cnt,
+          swap_ra_window);
+  printf ("File read-ahead: %lld pages, %lld hits\n",
+          file_ra_cnt, file_ra_hit_cnt);
+  printf ("Zero page: %lld read faults mapped, %lld pages copied on "
+          "write\n", zero_map_cnt, zero_copy_cnt);
+  printf ("madvise: %lld pages read in, %lld pages dropped\n",
+          willneed_cnt, dontneed_cnt);
+  printf ("msync: %lld pages written with %lld writes\n",
+          sync_page_cnt, sync_write_cnt);
+  printf ("mlock: %lld pages pinned, %lld calls over the %zu page "
+          "limit\n", mlock_cnt, mlock_refused_cnt, page_mlock_max);
+  printf ("Fault-around: %lld faults, %lld pages mapped around them\n",
+          fault_cnt, fault_around_cnt);
+  printf ("Large pages: %lld mapped, %lld split\n",
+          large_map_cnt, pagedir_split_cnt);
+  printf ("Page tables: %lld freed once empty\n", pagedir_reclaim_cnt);
+  printf ("Eager load: %lld pages with %lld file reads\n",
+          eager_page_cnt, eager_read_cnt);
 }
\ No newline at end of file
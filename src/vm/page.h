@@ -1,12 +1,49 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
 
-#include <hash.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 #include "threads/synch.h"
 #include "devices/block.h"
 
+/* Maximum size for process stack. */
+#define STACK_MAX (1024 * 1024)
+
+/* Most pages a process may lock with mlock (), chosen with 
+   "-mlock=PAGES". */
+extern size_t page_mlock_max;
+
+/* Resident-set cap of new processes in pages, chosen with 
+   "-rss=PAGES".  0 for no cap. */
+extern size_t page_rss_max;
+
+/* Pages in the block mapped around a faulting page when already in 
+   memory, chosen with "-around=PAGES".  0 or 1 to map only the 
+   faulting page. */
+extern size_t page_fault_around;
+
+/* Map big zero-filled parts of writable regions with 4 MB pages, 
+   chosen with "-large". */
+extern bool page_large;
+
+/* Executables up to this many pages long have their file pages read 
+   in and mapped by exec instead of on first use, chosen with 
+   "-eager=PAGES".  0 to always load lazily. */
+extern size_t page_eager_max;
+
+/* Advice given by madvise(), the same values as MADV_* in 
+   lib/user/syscall.h. */
+enum page_advice
+  {
+    PAGE_ADV_NORMAL,            /* Default read-ahead and eviction. */
+    PAGE_ADV_RANDOM,            /* No read-ahead. */
+    PAGE_ADV_SEQUENTIAL,        /* Read further ahead, evict soon after 
+                                   use. */
+    PAGE_ADV_WILLNEED,          /* Read the pages in now. */
+    PAGE_ADV_DONTNEED           /* Drop the pages' contents now. */
+  };
+
 /* Virtual page. */
 struct page 
   {
@@ -15,7 +52,19 @@ struct page
     struct thread *thread;      /* Thread owning the page */
     struct frame *frame;        /* Frame that the page is mapped to */
     bool read_only;             /* If page is ready only */
-    struct hash_elem hash_elem; /* hash table element */
+    bool cow;                   /* Writable page sharing its frame after 
+                                   fork, mapped read-only until the 
+                                   first write copies it. */
+    struct page *frame_next;    /* Next page sharing the frame */
+    bool zero;                  /* Mapped read-only to the shared zero 
+                                   page, has no frame yet. */
+    enum page_advice advice;    /* Access pattern given by madvise(), 
+                                   PAGE_ADV_NORMAL, _RANDOM or 
+                                   _SEQUENTIAL. */
+    bool pinned;                /* Locked by mlock (), keeps its frame 
+                                   until munlock (). */
+    bool referenced;            /* Accessed bit taken by the working-set 
+                                   scan, not yet seen by the clock. */
 
     /* Memory-mapped file information, protected by 
        frame->frame_acquire_lock. */
@@ -28,22 +77,54 @@ struct page
 
     /* Swap information, protected by frame->frame_acquire_lock. */
     block_sector_t sector;       /* Starting sector of swap area, or -1. */
+    bool readahead;              /* Read ahead from swap and not yet
+                                    seen accessed. */
+    bool prefetched;             /* Read ahead from file and not yet
+                                    faulted on. */
   };
 
+  /* Set up the shared zero page */
+  void page_init (void);
   /* Allocate a paage for given user space */
   struct page *page_allocation (void *, bool);
-  bool page_load (void *);
+  bool page_load (void *, bool);
 
-  /* hash table helper */
-  hash_hash_func page_get_hash;
-  /* hash table helper */
-  hash_less_func page_less;
-  /* free all pages in the page hash table */
+  /* free all pages in the supplemental page table */
   void page_exit (void);
   /* Returns true if the page is accessed, false otherwise */ 
   bool page_check_accessed (struct page *);
+  /* Sample the page's accessed bit for the working-set scan */
+  bool page_sample_accessed (struct page *);
+  /* Count the page into or out of its thread's resident set */
+  void page_rss_add (struct page *, int);
   /* Evict the page */
   bool page_evict (struct page *);
+  /* Drop the page of a process killed for memory from its frame */
+  void page_drop (struct page *);
+  /* Returns true if the page must be written out before eviction */
+  bool page_is_dirty (struct page *);
+  /* Write the page back without evicting it */
+  bool page_writeback (struct page *);
+  /* Returns true if the page is written back to swap, not to a file */
+  bool page_to_swap (struct page *);
+  /* Evict a frame's page and every page sharing the frame with it */
+  bool page_evict_shared (struct page *);
+  /* Give a copy-on-write page its own writable frame */
+  bool page_cow (void *);
+  /* Returns true if the page may share its frame with identical ones */
+  bool page_mergeable (struct page *);
+  /* Map the page read-only, copying it on the next write */
+  void page_protect (struct page *);
+  /* Let a page protected that way write again */
+  void page_unprotect (struct page *);
+  /* Move the page into another frame with the same contents */
+  void page_remap (struct page *, struct frame *);
+  /* Copy the given thread's pages into the current thread */
+  bool page_fork (struct thread *);
+  /* Evict several swap-backed pages with one swap write */
+  size_t page_evict_batch (struct page **, size_t);
+  /* Write several swap-backed pages back without evicting them */
+  size_t page_writeback_batch (struct page **, size_t);
   /* Zero the page. Helper function for loading page */
   void zeroing_page (struct page *);
   /* Helper function for lead to load from file. */
@@ -54,5 +135,21 @@ struct page
   void page_clear (void *);
   /* Find the page containning virtual address ADDRESS or grow stack */
   struct page *find_page (const void *, bool);
+  /* Find an existing page without creating one */
+  struct page *page_lookup (const void *);
+  /* Read in and map a range of the current thread's file pages */
+  void page_load_eager (void *, size_t);
+  /* Apply madvise() advice to a range of the current thread's pages */
+  bool page_advise (void *, size_t, enum page_advice);
+  /* Write back dirty pages of shared file mappings in a range */
+  void page_sync (void *, void *, bool);
+  /* Same, for msync (), checking the range first */
+  bool page_msync (void *, size_t, bool);
+  /* Fault in a range of the current thread's pages and pin them */
+  bool page_mlock (void *, size_t);
+  /* Unpin a range of the current thread's pages */
+  bool page_munlock (void *, size_t);
+  /* Print paging statistics */
+  void page_print_stats (void);
   
 #endif /* vm/page.h */
\ No newline at end of file
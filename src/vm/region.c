@@ -0,0 +1,197 @@
+#include "vm/region.h"
+#include <debug.h>
+#include <round.h>
+#include "vm/page.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+/* Returns true if the pages from START up to END overlap a region of
+   the current thread or a page that is not part of any region, that
+   is a stack page. */
+static bool
+region_overlaps (uint8_t *start, uint8_t *end)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  uint8_t *upage;
+
+  for (e = list_begin (&cur->regions); e != list_end (&cur->regions);
+       e = list_next (e))
+    {
+      struct region *r = list_entry (e, struct region, elem);
+      if (r->start >= end)
+        break;
+      if (r->end > start)
+        return true;
+    }
+
+  /* Only the stack lives outside regions, look for its pages. */
+  upage = start > (uint8_t *) PHYS_BASE - STACK_MAX
+          ? start : (uint8_t *) PHYS_BASE - STACK_MAX;
+  for (; upage < end; upage += PGSIZE)
+    if (page_lookup (upage) != NULL)
+      return true;
+  return false;
+}
+
+/* Map the SIZE bytes at page-aligned START into the current thread.
+   The first FILE_BYTES bytes come from FILE starting at OFFSET, the
+   rest is zero-filled.  FILE may be null if FILE_BYTES is 0.  Returns
+   false if the range is not in user space, overlaps memory already
+   mapped, or out of memory. */
+bool
+region_add (void *start, size_t size, struct file *file, off_t offset,
+            off_t file_bytes, bool read_only, bool private)
+{
+  struct thread *cur = thread_current ();
+  uint8_t *end = (uint8_t *) start + ROUND_UP (size, PGSIZE);
+  struct list_elem *e;
+  struct region *r;
+
+  ASSERT (pg_ofs (start) == 0);
+
+  if (start == NULL || end <= (uint8_t *) start || end > (uint8_t *) PHYS_BASE
+      || region_overlaps (start, end))
+    return false;
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return false;
+  r->start = start;
+  r->end = end;
+  r->file = file;
+  r->offset = offset;
+  r->file_bytes = file_bytes;
+  r->read_only = read_only;
+  r->private = private;
+
+  /* Keep the list sorted by address. */
+  for (e = list_begin (&cur->regions); e != list_end (&cur->regions);
+       e = list_next (e))
+    if (list_entry (e, struct region, elem)->start > r->start)
+      break;
+  list_insert (e, &r->elem);
+  return true;
+}
+
+/* Returns the current thread's region containing ADDR, or null. */
+struct region *
+region_find (const void *addr)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->regions); e != list_end (&cur->regions);
+       e = list_next (e))
+    {
+      struct region *r = list_entry (e, struct region, elem);
+      if ((const uint8_t *) addr < r->start)
+        break;
+      if ((const uint8_t *) addr < r->end)
+        return r;
+    }
+  return NULL;
+}
+
+/* Unmap the current thread's region starting at START.  Pages already
+   created in it are left to the caller. */
+void
+region_remove (void *start)
+{
+  struct region *r = region_find (start);
+  if (r != NULL && r->start == start)
+    {
+      list_remove (&r->elem);
+      free (r);
+    }
+}
+
+/* Move the current thread's program break INCREMENT bytes up or
+   down.  The heap is an anonymous region from heap_start up to the
+   break rounded up to a page, or no region while it is empty.  Its
+   pages are created on first use like those of any region, and the
+   pages it shrinks off are freed.  Returns the old break, or null if
+   the break would go below heap_start, or the heap would overlap
+   other memory or come within STACK_MAX of the top of user space. */
+void *
+region_sbrk (intptr_t increment)
+{
+  struct thread *cur = thread_current ();
+  uint8_t *old_brk = cur->brk;
+  uint8_t *limit = (uint8_t *) PHYS_BASE - STACK_MAX;
+  uint8_t *new_brk, *old_end, *new_end, *upage;
+  struct region *r;
+
+  if (increment >= 0 ? (uintptr_t) increment > (uintptr_t) (limit - old_brk)
+      : (uintptr_t) -increment > (uintptr_t) (old_brk - cur->heap_start))
+    return NULL;
+  new_brk = old_brk + increment;
+  old_end = (uint8_t *) ROUND_UP ((uintptr_t) old_brk, PGSIZE);
+  new_end = (uint8_t *) ROUND_UP ((uintptr_t) new_brk, PGSIZE);
+  r = old_end > cur->heap_start ? region_find (cur->heap_start) : NULL;
+  ASSERT (r == NULL || (r->start == cur->heap_start && r->end == old_end));
+
+  if (new_end > old_end)
+    {
+      if (r == NULL)
+        {
+          if (!region_add (cur->heap_start, new_end - cur->heap_start, NULL,
+                           0, 0, false, true))
+            return NULL;
+        }
+      else if (region_overlaps (old_end, new_end))
+        return NULL;
+      else
+        r->end = new_end;
+    }
+  else if (new_end < old_end)
+    {
+      /* Stop creating pages past the new end, then free those that 
+         were. */
+      if (new_end == cur->heap_start)
+        region_remove (cur->heap_start);
+      else
+        r->end = new_end;
+      pagedir_clear_range (cur->pagedir, new_end, old_end);
+      for (upage = new_end; upage < old_end; upage += PGSIZE)
+        page_clear (upage);
+    }
+  cur->brk = new_brk;
+  return old_brk;
+}
+
+/* Copy the regions of PARENT into the current thread, a child forked
+   from it, after files_fork() has copied the files they map. */
+bool
+region_fork (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->regions); e != list_end (&parent->regions);
+       e = list_next (e))
+    {
+      struct region *pr = list_entry (e, struct region, elem);
+      struct region *r = malloc (sizeof *r);
+      if (r == NULL)
+        return false;
+      *r = *pr;
+      if (pr->file != NULL)
+        r->file = files_fork_file (parent, pr->file);
+      list_push_back (&cur->regions, &r->elem);
+    }
+  return true;
+}
+
+/* Free all regions of the current thread. */
+void
+region_exit (void)
+{
+  struct list *regions = &thread_current ()->regions;
+
+  while (!list_empty (regions))
+    free (list_entry (list_pop_front (regions), struct region, elem));
+}
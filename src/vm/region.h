@@ -0,0 +1,42 @@
+#ifndef VM_REGION_H
+#define VM_REGION_H 1
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct thread;
+
+/* A range of a process's address space mapped to a file or to zeros.
+   The pages in it get a struct page only when first used, see
+   find_page(). */
+struct region
+  {
+    uint8_t *start;             /* First page of the region. */
+    uint8_t *end;               /* Page after the region. */
+    struct file *file;          /* Backing file, or null. */
+    off_t offset;               /* File offset of START. */
+    off_t file_bytes;           /* Bytes read from the file, the rest of
+                                   the region is zero-filled. */
+    bool read_only;             /* If the pages are read only. */
+    bool private;               /* False to write back to file,
+                                   true to write back to swap. */
+    struct list_elem elem;      /* Element in thread's region list. */
+  };
+
+/* Map a region into the current thread */
+bool region_add (void *, size_t, struct file *, off_t, off_t, bool, bool);
+/* Find the current thread's region containing an address */
+struct region *region_find (const void *);
+/* Unmap the current thread's region starting at an address */
+void region_remove (void *);
+/* Move the current thread's program break */
+void *region_sbrk (intptr_t);
+/* Copy the given thread's regions into the current thread */
+bool region_fork (struct thread *);
+/* Free all regions of the current thread */
+void region_exit (void);
+
+#endif /* vm/region.h */
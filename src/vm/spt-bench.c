@@ -0,0 +1,147 @@
+#include "vm/spt.h"
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+
+/* Microbenchmark of the supplemental page table against the hash
+   table it replaced.  Both index the same pages, laid out like a
+   process: half above the usual code address, half below the top of
+   the stack.  Run with the "spt-bench" kernel action. */
+
+#define BENCH_PAGES 1024                /* Pages in each table. */
+#define BENCH_BUILDS 200                /* Times each table is built. */
+#define BENCH_ROUNDS 2000               /* Lookups of each page. */
+
+/* A page in the hash table, as struct page used to carry. */
+struct bench_entry
+  {
+    void *vaddr;
+    struct hash_elem hash_elem;
+  };
+
+static unsigned
+bench_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct bench_entry *b = hash_entry (e, struct bench_entry, hash_elem);
+  return ((uintptr_t) b->vaddr) >> PGBITS;
+}
+
+static bool
+bench_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return hash_entry (a, struct bench_entry, hash_elem)->vaddr
+         < hash_entry (b, struct bench_entry, hash_elem)->vaddr;
+}
+
+/* Prints one line of results. */
+static void
+bench_report (const char *name, int64_t build, int64_t lookup, size_t bytes)
+{
+  long long ns_per_tick = 1000000000 / TIMER_FREQ;
+
+  printf ("spt-bench: %-5s build %4lld ticks (%6lld ns/insert), "
+          "lookup %4lld ticks (%4lld ns/lookup), %6zu bytes\n",
+          name, build, build * ns_per_tick / (BENCH_BUILDS * BENCH_PAGES),
+          lookup, lookup * ns_per_tick
+                  / ((long long) BENCH_ROUNDS * BENCH_PAGES),
+          bytes);
+}
+
+void
+spt_bench (char **argv UNUSED)
+{
+  struct page *pages = malloc (BENCH_PAGES * sizeof *pages);
+  struct bench_entry *entries = malloc (BENCH_PAGES * sizeof *entries);
+  void **order = malloc (BENCH_PAGES * sizeof *order);
+  struct sup_page_table *spt = NULL;
+  struct bench_entry key;
+  struct hash h;
+  int64_t start, build, lookup;
+  size_t found, bytes;
+  int i, r;
+
+  if (pages == NULL || entries == NULL || order == NULL)
+    PANIC ("spt-bench: out of memory");
+
+  for (i = 0; i < BENCH_PAGES; i++)
+    {
+      uint8_t *upage = i < BENCH_PAGES / 2
+                       ? (uint8_t *) 0x08048000 + i * PGSIZE
+                       : (uint8_t *) PHYS_BASE - (BENCH_PAGES - i) * PGSIZE;
+      pages[i].vaddr = entries[i].vaddr = order[i] = upage;
+    }
+  /* Look the pages up in random order. */
+  for (i = BENCH_PAGES - 1; i > 0; i--)
+    {
+      int j = random_ulong () % (i + 1);
+      void *t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+
+  printf ("spt-bench: %d pages, %d builds, %lld lookups\n", BENCH_PAGES,
+          BENCH_BUILDS, (long long) BENCH_ROUNDS * BENCH_PAGES);
+
+  /* Hash table. */
+  start = timer_ticks ();
+  for (r = 0; r < BENCH_BUILDS; r++)
+    {
+      if (r > 0)
+        hash_destroy (&h, NULL);
+      if (!hash_init (&h, bench_hash, bench_less, NULL))
+        PANIC ("spt-bench: out of memory");
+      for (i = 0; i < BENCH_PAGES; i++)
+        hash_insert (&h, &entries[i].hash_elem);
+    }
+  build = timer_elapsed (start);
+
+  found = 0;
+  start = timer_ticks ();
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    for (i = 0; i < BENCH_PAGES; i++)
+      {
+        key.vaddr = order[i];
+        found += hash_find (&h, &key.hash_elem) != NULL;
+      }
+  lookup = timer_elapsed (start);
+  ASSERT (found == (size_t) BENCH_ROUNDS * BENCH_PAGES);
+  bytes = sizeof h + h.bucket_cnt * sizeof *h.buckets
+          + BENCH_PAGES * sizeof (struct hash_elem);
+  bench_report ("hash", build, lookup, bytes);
+  hash_destroy (&h, NULL);
+
+  /* Radix table. */
+  start = timer_ticks ();
+  for (r = 0; r < BENCH_BUILDS; r++)
+    {
+      if (spt != NULL)
+        spt_destroy (spt, NULL);
+      spt = spt_create ();
+      if (spt == NULL)
+        PANIC ("spt-bench: out of memory");
+      for (i = 0; i < BENCH_PAGES; i++)
+        spt_insert (spt, &pages[i]);
+    }
+  build = timer_elapsed (start);
+
+  found = 0;
+  start = timer_ticks ();
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    for (i = 0; i < BENCH_PAGES; i++)
+      found += spt_find (spt, order[i]) != NULL;
+  lookup = timer_elapsed (start);
+  ASSERT (found == (size_t) BENCH_ROUNDS * BENCH_PAGES);
+  bytes = (1 + spt->leaf_cnt) * PGSIZE;
+  bench_report ("radix", build, lookup, bytes);
+  spt_destroy (spt, NULL);
+
+  free (order);
+  free (entries);
+  free (pages);
+}
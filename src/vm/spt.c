@@ -0,0 +1,81 @@
+#include "vm/spt.h"
+#include <debug.h>
+#include "vm/page.h"
+#include "threads/palloc.h"
+
+/* Returns a new, empty table, or null if out of memory. */
+struct sup_page_table *
+spt_create (void)
+{
+  return palloc_get_page (PAL_ZERO);
+}
+
+/* Call ACTION, if not null, on each page of SPT and free the table. */
+void
+spt_destroy (struct sup_page_table *spt, void (*action) (struct page *))
+{
+  size_t i, j;
+
+  for (i = 0; i < SPT_ROOT_CNT; i++)
+    if (spt->leaves[i] != NULL)
+      {
+        if (action != NULL)
+          for (j = 0; j < SPT_LEAF_CNT; j++)
+            if (spt->leaves[i][j] != NULL)
+              action (spt->leaves[i][j]);
+        palloc_free_page (spt->leaves[i]);
+      }
+  palloc_free_page (spt);
+}
+
+/* Add P to SPT at P->vaddr.  Returns false if the address already has
+   a page or a leaf cannot be allocated. */
+bool
+spt_insert (struct sup_page_table *spt, struct page *p)
+{
+  struct page ***leaf;
+
+  ASSERT (is_user_vaddr (p->vaddr));
+
+  leaf = &spt->leaves[pd_no (p->vaddr)];
+  if (*leaf == NULL)
+    {
+      *leaf = palloc_get_page (PAL_ZERO);
+      if (*leaf == NULL)
+        return false;
+      spt->leaf_cnt++;
+    }
+  if ((*leaf)[pt_no (p->vaddr)] != NULL)
+    return false;
+  (*leaf)[pt_no (p->vaddr)] = p;
+  spt->page_cnt++;
+  return true;
+}
+
+/* Remove P from SPT.  Leaves are kept until the table is destroyed. */
+void
+spt_remove (struct sup_page_table *spt, struct page *p)
+{
+  struct page **leaf = spt->leaves[pd_no (p->vaddr)];
+
+  ASSERT (leaf != NULL && leaf[pt_no (p->vaddr)] == p);
+  leaf[pt_no (p->vaddr)] = NULL;
+  spt->page_cnt--;
+}
+
+/* Call ACTION on each page of SPT in address order, with AUX.  Returns
+   false as soon as ACTION does, true otherwise.  ACTION may remove the
+   page it is given. */
+bool
+spt_for_each (struct sup_page_table *spt, spt_action_func *action,
+              void *aux)
+{
+  size_t i, j;
+
+  for (i = 0; i < SPT_ROOT_CNT; i++)
+    if (spt->leaves[i] != NULL)
+      for (j = 0; j < SPT_LEAF_CNT; j++)
+        if (spt->leaves[i][j] != NULL && !action (spt->leaves[i][j], aux))
+          return false;
+  return true;
+}
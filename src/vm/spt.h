@@ -0,0 +1,57 @@
+#ifndef VM_SPT_H
+#define VM_SPT_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/loader.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+struct page;
+
+/* Pages covered by a leaf, as many as a hardware page table. */
+#define SPT_LEAF_CNT (1 << PTBITS)
+/* Leaves needed to cover user space. */
+#define SPT_ROOT_CNT (LOADER_PHYS_BASE >> PDSHIFT)
+
+/* Supplemental page table, shaped like the hardware one: the page
+   directory index of a user address picks a leaf, its page table
+   index picks the page in the leaf.  Leaves are allocated on first
+   use and hold null for addresses that have no page. */
+struct sup_page_table
+  {
+    struct page **leaves[SPT_ROOT_CNT]; /* Leaf per 4 MB, or null. */
+    size_t leaf_cnt;                    /* Number of leaves. */
+    size_t page_cnt;                    /* Number of pages. */
+  };
+
+/* Called on each page by spt_for_each(), which stops when it returns
+   false. */
+typedef bool spt_action_func (struct page *, void *aux);
+
+/* Create an empty supplemental page table */
+struct sup_page_table *spt_create (void);
+/* Destroy a table, calling a function on each of its pages first */
+void spt_destroy (struct sup_page_table *, void (*) (struct page *));
+/* Add a page, fails if its address already has one */
+bool spt_insert (struct sup_page_table *, struct page *);
+/* Remove a page */
+void spt_remove (struct sup_page_table *, struct page *);
+/* Call a function on each page in address order */
+bool spt_for_each (struct sup_page_table *, spt_action_func *, void *);
+/* Compare the table against a hash table, "spt-bench" action */
+void spt_bench (char **argv);
+
+/* Returns the page of SPT containing user address ADDR, or null. */
+static inline struct page *
+spt_find (const struct sup_page_table *spt, const void *addr)
+{
+  struct page **leaf;
+
+  if (!is_user_vaddr (addr))
+    return NULL;
+  leaf = spt->leaves[pd_no (addr)];
+  return leaf != NULL ? leaf[pt_no (addr)] : NULL;
+}
+
+#endif /* vm/spt.h */
@@ -1,15 +1,22 @@
 #include "vm/swap.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <list.h>
 #include <stdio.h>
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/zswap.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/block.h"
 #include "userprog/syscall.h"
 
-/* lock for swap to prevent race. */
+/* lock for swap to prevent race.  It covers the slot bitmap and 
+   reference counts only, never the I/O: a slot cannot be freed or 
+   handed out again while a page holds a reference to it, and a page 
+   keeps its reference until its I/O is complete. */
 static struct lock swap_lock;
 
 /* Swap block. */
@@ -18,6 +25,52 @@ static struct block *swap_block;
 /* Bitmap of free swap slots. */
 static struct bitmap *swap_table;
 
+/* Next-fit cursor, the slot after the last one handed out. */
+static size_t swap_cursor;
+
+/* Slots on the swap device.  Slots from disk_slots up are entries of 
+   the compressed tier in memory, see vm/zswap.c. */
+static size_t disk_slots;
+
+/* Number of pages holding each in-use slot.  A slot is shared when a 
+   forked process inherits a swapped-out page. */
+static unsigned short *swap_refs;
+
+/* References to slots, the sum of swap_refs, and pages holding a slot. 
+   The two differ by the references leaked. */
+static size_t swap_ref_cnt;
+static size_t swap_hold_cnt;
+
+/* Swap-in statistics. */
+static long long zswap_in_cnt;
+static long long disk_in_cnt;
+
+/* A batch of page transfers to or from the swap device, queued for the 
+   swap-io thread by a faulting or evicting thread, which sleeps until 
+   DONE is up. */
+struct swap_request
+  {
+    struct page **pages;        /* Pages, sorted by sector. */
+    size_t cnt;                 /* Number of pages. */
+    bool write;                 /* Write to the device, or read. */
+    struct semaphore done;      /* Upped once every page is through. */
+    struct list_elem elem;      /* Element in swap_io_queue. */
+  };
+
+/* Requests not yet taken by the swap-io thread, sorted by their first 
+   sector, protected by swap_io_lock. */
+static struct list swap_io_queue;
+static struct lock swap_io_lock;
+static struct condition swap_io_cond;
+
+/* Swap I/O statistics. */
+static long long io_request_cnt;        /* Requests served. */
+static long long io_pass_cnt;           /* Passes over the queue. */
+static size_t io_queue_max;             /* Most requests in one pass. */
+
+static void swap_release (size_t slot);
+static thread_func swap_io_thread NO_RETURN;
+
 void
 swap_init (void)
 {
@@ -32,55 +85,379 @@ swap_init (void)
                                  / SECTORS_PER_PAGE);
   if (swap_table == NULL)
     handle_exit (-1);
+  disk_slots = bitmap_size (swap_table);
+  zswap_init ();
+  swap_refs = calloc (disk_slots + zswap_capacity () + 1, 
+                      sizeof *swap_refs);
+  if (swap_refs == NULL)
+    handle_exit (-1);
   lock_init (&swap_lock);
+
+  list_init (&swap_io_queue);
+  lock_init (&swap_io_lock);
+  cond_init (&swap_io_cond);
+  if (swap_block != NULL)
+    thread_create ("swap-io", PRI_MAX, swap_io_thread, NULL);
+}
+
+/* Transfer the CNT pages in PAGES, sorted by sector and with their 
+   frames locked, to or from their disk slots through the swap-io 
+   thread.  Returns when the transfer is complete. */
+static void
+swap_io (struct page **pages, size_t cnt, bool write)
+{
+  struct swap_request r;
+  struct list_elem *e;
+
+  if (cnt == 0)
+    return;
+  r.pages = pages;
+  r.cnt = cnt;
+  r.write = write;
+  sema_init (&r.done, 0);
+
+  lock_acquire (&swap_io_lock);
+  for (e = list_begin (&swap_io_queue); e != list_end (&swap_io_queue);
+       e = list_next (e))
+    if (list_entry (e, struct swap_request, elem)->pages[0]->sector
+        > pages[0]->sector)
+      break;
+  list_insert (e, &r.elem);
+  cond_signal (&swap_io_cond, &swap_io_lock);
+  lock_release (&swap_io_lock);
+
+  sema_down (&r.done);
+}
+
+/* Moves the pages of request R between their frames and the swap 
+   device. */
+static void
+swap_io_serve (struct swap_request *r)
+{
+  for (size_t i = 0; i < r->cnt; i++)
+    {
+      struct page *p = r->pages[i];
+      uint8_t *kpage = p->frame->kernel_virtual_address;
+
+      for (size_t j = 0; j < SECTORS_PER_PAGE; j++)
+        if (r->write)
+          block_write (swap_block, p->sector + j, 
+                       kpage + j * BLOCK_SECTOR_SIZE);
+        else
+          block_read (swap_block, p->sector + j, 
+                      kpage + j * BLOCK_SECTOR_SIZE);
+    }
+}
+
+/* Swap I/O thread.  Takes every queued request at once and serves them 
+   in sector order, one sweep across the device, so that threads 
+   faulting together share a pass instead of queueing on a lock one 
+   disk transfer at a time. */
+static void
+swap_io_thread (void *aux UNUSED)
+{
+  struct list batch;
+
+  for (;;)
+    {
+      size_t cnt = 0;
+
+      lock_acquire (&swap_io_lock);
+      while (list_empty (&swap_io_queue))
+        cond_wait (&swap_io_cond, &swap_io_lock);
+      list_init (&batch);
+      while (!list_empty (&swap_io_queue))
+        list_push_back (&batch, list_pop_front (&swap_io_queue));
+      lock_release (&swap_io_lock);
+
+      while (!list_empty (&batch))
+        {
+          struct swap_request *r = list_entry (list_pop_front (&batch),
+                                               struct swap_request, elem);
+          swap_io_serve (r);
+          if (!r->write)
+            disk_in_cnt += r->cnt;
+          cnt++;
+          sema_up (&r->done);
+        }
+      io_request_cnt += cnt;
+      io_pass_cnt++;
+      if (cnt > io_queue_max)
+        io_queue_max = cnt;
+    }
+}
+
+/* Drop one reference to SLOT and free it once nobody holds it.  The 
+   caller must hold swap_lock. */
+static void
+swap_release (size_t slot)
+{
+  ASSERT (swap_refs[slot] > 0);
+  swap_ref_cnt--;
+  if (--swap_refs[slot] > 0)
+    return;
+  if (slot >= disk_slots)
+    zswap_free (slot - disk_slots);
+  else
+    bitmap_reset (swap_table, slot);
+}
+
+/* Point page P at the slot starting at SECTOR, or at none if SECTOR is 
+   -1, keeping count of the pages holding a slot in P's process and in 
+   the system.  The caller must hold swap_lock. */
+static void
+swap_set_sector (struct page *p, block_sector_t sector)
+{
+  bool had = p->sector != (block_sector_t) -1;
+  bool has = sector != (block_sector_t) -1;
+
+  if (has && !had)
+    {
+      p->thread->swap_cnt++;
+      swap_hold_cnt++;
+    }
+  else if (had && !has)
+    {
+      p->thread->swap_cnt--;
+      swap_hold_cnt--;
+    }
+  p->sector = sector;
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  long long in_cnt = zswap_in_cnt + disk_in_cnt;
+  size_t slot_cnt = disk_slots + zswap_capacity ();
+  size_t used = 0;
+
+  lock_acquire (&swap_lock);
+  for (size_t i = 0; i < slot_cnt; i++)
+    if (swap_refs[i] > 0)
+      used++;
+  lock_release (&swap_lock);
+
+  printf ("Swap: %lld pages in from compressed tier, %lld from disk, "
+          "%lld%% tier hits\n", zswap_in_cnt, disk_in_cnt,
+          in_cnt > 0 ? zswap_in_cnt * 100 / in_cnt : 0);
+  printf ("Swap slots: %zu total, %zu used, %zu references leaked\n",
+          slot_cnt, used, swap_ref_cnt - swap_hold_cnt);
+  printf ("Swap I/O: %lld requests in %lld passes, up to %zu per pass\n",
+          io_request_cnt, io_pass_cnt, io_queue_max);
+  zswap_print_stats ();
+}
+
+/* Let page P, which has no swap slot, share the slot starting at 
+   SECTOR with the pages holding it already. */
+void
+swap_share (struct page *p, block_sector_t sector)
+{
+  ASSERT (p->sector == (block_sector_t) -1);
+
+  lock_acquire (&swap_lock);
+  swap_refs[sector / SECTORS_PER_PAGE]++;
+  swap_ref_cnt++;
+  swap_set_sector (p, sector);
+  lock_release (&swap_lock);
+}
+
+/* Release page P's hold on its swap slot, if it has one, without 
+   reading the slot back. */
+void
+swap_drop (struct page *p)
+{
+  if (p->sector == (block_sector_t) -1)
+    return;
+  lock_acquire (&swap_lock);
+  swap_release (p->sector / SECTORS_PER_PAGE);
+  swap_set_sector (p, (block_sector_t) -1);
+  lock_release (&swap_lock);
 }
 
 /* Swaps in the page from disk to frame. */
 void
 swap_in (struct page *p)
 {
-  if (!swap_block || !swap_table)
+  swap_in_batch (&p, 1);
+}
+
+/* Swaps in the CNT pages in PAGES, whose frames the caller has locked. 
+   The slots are read in sector order so that pages swapped out together 
+   come back in one sequential read.  Compressed pages are decompressed 
+   right here, the others are read by the swap-io thread. */
+void
+swap_in_batch (struct page **pages, size_t cnt)
+{
+  struct page *sorted[SWAP_BATCH_MAX];
+  struct page *disk[SWAP_BATCH_MAX];
+  size_t disk_cnt = 0;
+  size_t i, j;
+
+  ASSERT (cnt <= SWAP_BATCH_MAX);
+  if (!swap_table)
     return;
-  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = pages[i];
+      for (j = i; j > 0 && sorted[j - 1]->sector > p->sector; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = p;
+    }
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = sorted[i];
+      size_t slot = p->sector / SECTORS_PER_PAGE;
+      if (slot >= disk_slots)
+        /* Kept compressed in memory. */
+        zswap_load (slot - disk_slots, p->frame->kernel_virtual_address);
+      else
+        disk[disk_cnt++] = p;
+    }
+  swap_io (disk, disk_cnt, false);
+
   lock_acquire (&swap_lock);
-  for (i = 0; i < SECTORS_PER_PAGE; i++)
-      /* Read in page sectors. */
-      block_read (swap_block, p->sector + i,
-                  p->frame->kernel_virtual_address + i * BLOCK_SECTOR_SIZE);
-  /* Free a swap slot when its contents are read back into a frame. */
-  bitmap_reset (swap_table, p->sector / SECTORS_PER_PAGE);
+  zswap_in_cnt += cnt - disk_cnt;
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = sorted[i];
+      /* Free a swap slot when its contents are read back into a frame, 
+         unless another page still shares it. */
+      swap_release (p->sector / SECTORS_PER_PAGE);
+      swap_set_sector (p, (block_sector_t) -1);
+    }
   lock_release (&swap_lock);
-  p->sector = (block_sector_t) -1;
+}
+
+/* Allocate CNT adjacent swap slots, searching next-fit from the last 
+   allocation.  Returns the first slot or BITMAP_ERROR.  The caller must 
+   hold swap_lock. */
+static size_t
+swap_alloc (size_t cnt)
+{
+  size_t slot = bitmap_scan (swap_table, swap_cursor, cnt, false);
+  if (slot == BITMAP_ERROR && swap_cursor != 0)
+    /* Wrap around to the start of the swap area. */
+    slot = bitmap_scan (swap_table, 0, cnt, false);
+  if (slot == BITMAP_ERROR)
+    return BITMAP_ERROR;
+
+  bitmap_set_multiple (swap_table, slot, cnt, true);
+  for (size_t i = 0; i < cnt; i++)
+    swap_refs[slot + i] = 1;
+  swap_ref_cnt += cnt;
+  swap_cursor = slot + cnt;
+  if (swap_cursor >= bitmap_size (swap_table))
+    swap_cursor = 0;
+  return slot;
 }
 
 /* Swap out the page from frame to disk */
 bool
 swap_out (struct page *p)
 {
-  if (!swap_block || !swap_table)
-    return false;
-  size_t i;
+  return swap_out_batch (&p, 1) == 1;
+}
+
+/* Swap out the CNT pages in PAGES, whose frames the caller has locked. 
+   Pages that compress well go to the compressed tier in memory while it 
+   has room.  The others without a slot are given a run of adjacent 
+   slots where possible, and all pages are written in slot order, so the 
+   disk sees one sequential burst instead of scattered writes.  Pages 
+   that cannot get a slot are left with sector -1.  Returns the number 
+   of pages written. */
+size_t
+swap_out_batch (struct page **pages, size_t cnt)
+{
+  struct page *sorted[SWAP_BATCH_MAX];
+  size_t need = 0;
+  size_t done = 0;
+  size_t i, j;
+
+  ASSERT (cnt <= SWAP_BATCH_MAX);
+  if (!swap_table)
+    return 0;
+
+  /* A page that was written back earlier keeps its disk slot, unless a 
+     forked process shares the slot.  A compressed copy cannot be 
+     rewritten in place.  Use swap_lock to prevent race. */
+  lock_acquire (&swap_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      block_sector_t sector = pages[i]->sector;
+      if (sector != (block_sector_t) -1 
+          && (swap_refs[sector / SECTORS_PER_PAGE] > 1
+              || sector / SECTORS_PER_PAGE >= disk_slots))
+        {
+          swap_release (sector / SECTORS_PER_PAGE);
+          swap_set_sector (pages[i], (block_sector_t) -1);
+        }
+    }
+  lock_release (&swap_lock);
+
+  /* Try the compressed tier first. */
+  for (i = 0; i < cnt; i++)
+    if (pages[i]->sector == (block_sector_t) -1)
+      {
+        size_t idx = zswap_store (pages[i]->frame->kernel_virtual_address);
+        if (idx == ZSWAP_ERROR)
+          {
+            need++;
+            continue;
+          }
+        lock_acquire (&swap_lock);
+        swap_refs[disk_slots + idx] = 1;
+        swap_ref_cnt++;
+        swap_set_sector (pages[i], (disk_slots + idx) * SECTORS_PER_PAGE);
+        lock_release (&swap_lock);
+      }
 
-  /* Find a free swap slot. Use swap_lock to prevent race. */
+  /* The rest get a cluster on disk. */
   lock_acquire (&swap_lock);
-  size_t open_slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+  if (need > 0)
+    {
+      size_t run = swap_alloc (need);
+      for (i = 0; i < cnt; i++)
+        if (pages[i]->sector == (block_sector_t) -1)
+          {
+            /* Without a cluster, fall back to single slots. */
+            size_t slot = run != BITMAP_ERROR ? run++ : swap_alloc (1);
+            if (slot != BITMAP_ERROR)
+              swap_set_sector (pages[i], slot * SECTORS_PER_PAGE);
+          }
+    }
   lock_release (&swap_lock);
 
-  if (open_slot == BITMAP_ERROR)
-    /* No free swap slots. */
-    return false;
-
-  p->sector = open_slot * SECTORS_PER_PAGE;
-
-  for (i = 0; i < SECTORS_PER_PAGE; i++)
-    /* Write page sectors to swap block. */
-    block_write (swap_block, p->sector + i,
-                 (uint8_t *) p->frame->kernel_virtual_address 
-                 + i * BLOCK_SECTOR_SIZE);
-  /* Reset page. */
-  p->file_offset = 0;
-  p->file_bytes = 0;
-  p->file = NULL;
-  p->private = false;
-  return true;
-}
\ No newline at end of file
+  /* Sort the pages that have a slot by sector. */
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = pages[i];
+      if (p->sector == (block_sector_t) -1)
+        /* No free swap slots. */
+        continue;
+      for (j = done; j > 0 && sorted[j - 1]->sector > p->sector; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = p;
+      done++;
+    }
+
+  /* Pages on disk are written by the swap-io thread, compressed ones 
+     are in place already.  Sorting put the disk pages first. */
+  for (i = 0; i < done && sorted[i]->sector / SECTORS_PER_PAGE < disk_slots;
+       i++)
+    continue;
+  swap_io (sorted, i, true);
+
+  for (i = 0; i < done; i++)
+    {
+      struct page *p = sorted[i];
+      /* Reset page. */
+      p->file_offset = 0;
+      p->file_bytes = 0;
+      p->file = NULL;
+      p->private = false;
+    }
+  return done;
+}
@@ -2,16 +2,31 @@
 #define VM_SWAP_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
 
 #define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
 
+/* Maximum number of pages swapped out together by swap_out_batch(). */
+#define SWAP_BATCH_MAX 16
+
 struct page;
 
 /* Initiallize swap table. */
 void swap_init (void);
 /* Swaps in the page from disk to memory. */
 void swap_in (struct page *);
+/* Swaps in several pages, reading their slots in order */
+void swap_in_batch (struct page **, size_t);
 /* Swap out the page to disk */
 bool swap_out (struct page *);
+/* Swap out several pages to adjacent slots */
+size_t swap_out_batch (struct page **, size_t);
+/* Share a swap slot with one more page */
+void swap_share (struct page *, block_sector_t);
+/* Give up a page's hold on its swap slot */
+void swap_drop (struct page *);
+/* Print swap statistics */
+void swap_print_stats (void);
 
 #endif /* vm/swap.h */
@@ -0,0 +1,264 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap tier.  Evicted pages are compressed into an arena of
+   kernel pages, carved into ZSWAP_CHUNK byte chunks, and only go to
+   the swap device when the arena is full or the page does not
+   compress to ZSWAP_MAX_LEN bytes or less. */
+
+#define ZSWAP_CHUNK 64
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* Compressor dictionary: last position + 1 of each 3-byte hash. */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 15)
+
+size_t zswap_pages = 32;
+
+/* A compressed page. */
+struct zswap_entry
+  {
+    size_t chunk;                       /* First chunk in the arena. */
+    size_t len;                         /* Compressed length in bytes. */
+  };
+
+/* Everything below is protected by zswap_lock. */
+static struct lock zswap_lock;
+static uint8_t *arena;                  /* Arena base. */
+static struct bitmap *used_chunks;      /* Arena chunks in use. */
+static struct bitmap *used_entries;     /* Entries in use. */
+static struct zswap_entry *entries;
+static size_t entry_cnt;
+
+/* Scratch buffer and dictionary for the compressor. */
+static uint8_t zbuf[ZSWAP_MAX_LEN];
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+/* Statistics. */
+static long long stored_cnt;
+static long long stored_bytes;
+static long long incompressible_cnt;
+static long long full_cnt;
+
+static size_t lz_compress (const uint8_t *, uint8_t *, size_t);
+static bool lz_decompress (const uint8_t *, size_t, uint8_t *);
+
+/* Set aside zswap_pages kernel pages for the compressed tier.  The
+   tier stays empty if they cannot be had. */
+void
+zswap_init (void)
+{
+  lock_init (&zswap_lock);
+  if (zswap_pages == 0)
+    return;
+
+  arena = palloc_get_multiple (0, zswap_pages);
+  if (arena == NULL)
+    {
+      printf ("zswap: cannot allocate %zu pages, disabled\n", zswap_pages);
+      return;
+    }
+  entry_cnt = zswap_pages * PGSIZE / ZSWAP_CHUNK;
+  used_chunks = bitmap_create (entry_cnt);
+  used_entries = bitmap_create (entry_cnt);
+  entries = malloc (sizeof *entries * entry_cnt);
+  if (used_chunks == NULL || used_entries == NULL || entries == NULL)
+    PANIC ("zswap: out of memory");
+}
+
+/* Returns the number of pages the tier can hold at most. */
+size_t
+zswap_capacity (void)
+{
+  return entry_cnt;
+}
+
+/* Compress the page at KPAGE into the tier.  Returns its entry, or
+   ZSWAP_ERROR if it does not compress well or does not fit. */
+size_t
+zswap_store (const void *kpage)
+{
+  size_t len, chunk_cnt, chunk, idx;
+
+  if (entry_cnt == 0)
+    return ZSWAP_ERROR;
+
+  lock_acquire (&zswap_lock);
+  len = lz_compress (kpage, zbuf, sizeof zbuf);
+  if (len == 0)
+    {
+      incompressible_cnt++;
+      lock_release (&zswap_lock);
+      return ZSWAP_ERROR;
+    }
+
+  chunk_cnt = DIV_ROUND_UP (len, ZSWAP_CHUNK);
+  chunk = bitmap_scan_and_flip (used_chunks, 0, chunk_cnt, false);
+  if (chunk == BITMAP_ERROR)
+    {
+      full_cnt++;
+      lock_release (&zswap_lock);
+      return ZSWAP_ERROR;
+    }
+  idx = bitmap_scan_and_flip (used_entries, 0, 1, false);
+  ASSERT (idx != BITMAP_ERROR);
+
+  memcpy (arena + chunk * ZSWAP_CHUNK, zbuf, len);
+  entries[idx].chunk = chunk;
+  entries[idx].len = len;
+  stored_cnt++;
+  stored_bytes += len;
+  lock_release (&zswap_lock);
+  return idx;
+}
+
+/* Decompress entry IDX into the page at KPAGE.  The entry stays in the
+   tier until zswap_free() is called. */
+void
+zswap_load (size_t idx, void *kpage)
+{
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (used_entries, idx));
+  if (!lz_decompress (arena + entries[idx].chunk * ZSWAP_CHUNK,
+                      entries[idx].len, kpage))
+    PANIC ("zswap: entry %zu is corrupt", idx);
+  lock_release (&zswap_lock);
+}
+
+/* Free entry IDX and its chunks. */
+void
+zswap_free (size_t idx)
+{
+  lock_acquire (&zswap_lock);
+  ASSERT (bitmap_test (used_entries, idx));
+  bitmap_set_multiple (used_chunks, entries[idx].chunk,
+                       DIV_ROUND_UP (entries[idx].len, ZSWAP_CHUNK), false);
+  bitmap_reset (used_entries, idx);
+  lock_release (&zswap_lock);
+}
+
+/* Prints compression statistics. */
+void
+zswap_print_stats (void)
+{
+  long long ratio = stored_bytes > 0 ? stored_cnt * PGSIZE * 100
+                                       / stored_bytes : 0;
+
+  printf ("Compressed swap: %zu pages, %lld pages stored, ratio %lld.%02lld,"
+          " %lld incompressible, %lld arena full\n",
+          zswap_pages, stored_cnt, ratio / 100, ratio % 100,
+          incompressible_cnt, full_cnt);
+}
+
+/* Hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p)
+{
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compress the page at SRC into DST, at most CAP bytes, LZRW1-style.
+   Items come in groups of up to 16, each group led by a 16-bit little
+   endian control word whose bit I tells whether item I is a literal
+   byte (0) or a 2-byte match (1).  A match is 4 bits of length minus
+   LZ_MIN_MATCH and 12 bits of distance back into the output.  Returns
+   the compressed length, or 0 if it would exceed CAP. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t cap)
+{
+  size_t in = 0, out = 0;
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (in < PGSIZE)
+    {
+      size_t ctrl_ofs = out;
+      unsigned ctrl = 0;
+      int bit;
+
+      /* Room for a control word and 16 matches. */
+      if (out + 2 + 16 * 2 > cap)
+        return 0;
+      out += 2;
+
+      for (bit = 0; bit < 16 && in < PGSIZE; bit++)
+        {
+          if (in + LZ_MIN_MATCH <= PGSIZE)
+            {
+              unsigned h = lz_hash (src + in);
+              size_t cand = lz_table[h];
+              lz_table[h] = in + 1;
+              if (cand-- != 0
+                  && !memcmp (src + cand, src + in, LZ_MIN_MATCH))
+                {
+                  size_t dist = in - cand;
+                  size_t len = LZ_MIN_MATCH;
+                  while (len < LZ_MAX_MATCH && in + len < PGSIZE
+                         && src[cand + len] == src[in + len])
+                    len++;
+                  dst[out++] = ((len - LZ_MIN_MATCH) << 4) | (dist >> 8);
+                  dst[out++] = dist & 0xff;
+                  ctrl |= 1u << bit;
+                  in += len;
+                  continue;
+                }
+            }
+          dst[out++] = src[in++];
+        }
+      dst[ctrl_ofs] = ctrl & 0xff;
+      dst[ctrl_ofs + 1] = ctrl >> 8;
+    }
+  return out;
+}
+
+/* Decompress LEN bytes at SRC, written by lz_compress(), into the page
+   at DST.  Returns false if SRC is malformed. */
+static bool
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst)
+{
+  size_t in = 0, out = 0;
+
+  while (out < PGSIZE)
+    {
+      unsigned ctrl;
+      int bit;
+
+      if (in + 2 > len)
+        return false;
+      ctrl = src[in] | (src[in + 1] << 8);
+      in += 2;
+
+      for (bit = 0; bit < 16 && out < PGSIZE; bit++)
+        if (ctrl & (1u << bit))
+          {
+            size_t n, dist;
+            if (in + 2 > len)
+              return false;
+            n = (src[in] >> 4) + LZ_MIN_MATCH;
+            dist = ((src[in] & 0xf) << 8) | src[in + 1];
+            in += 2;
+            if (dist == 0 || dist > out || out + n > PGSIZE)
+              return false;
+            /* Byte by byte, the match may overlap its own output. */
+            for (; n > 0; n--, out++)
+              dst[out] = dst[out - dist];
+          }
+        else
+          {
+            if (in >= len)
+              return false;
+            dst[out++] = src[in++];
+          }
+    }
+  return true;
+}
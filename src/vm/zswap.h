@@ -0,0 +1,26 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H 1
+
+#include <stddef.h>
+
+/* Returned by zswap_store() when a page is not kept in memory. */
+#define ZSWAP_ERROR ((size_t) -1)
+
+/* Kernel pages given to the compressed swap tier, chosen with
+   "-zswap=PAGES".  0 sends every page to the swap device. */
+extern size_t zswap_pages;
+
+/* Initialize the compressed swap tier. */
+void zswap_init (void);
+/* Number of pages the tier can hold at most */
+size_t zswap_capacity (void);
+/* Compress a page into the tier */
+size_t zswap_store (const void *);
+/* Decompress a page out of the tier */
+void zswap_load (size_t, void *);
+/* Free a page kept in the tier */
+void zswap_free (size_t);
+/* Print compression statistics */
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */